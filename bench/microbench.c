@@ -0,0 +1,346 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "client.h"
+#include "configure.h"
+#include "helper.h"
+#include "howm.h"
+#include "location.h"
+#include "op.h"
+#include "types.h"
+#include "workspace.h"
+
+/**
+ * @file microbench.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Microbenchmarks of the operations on howm's client and workspace
+ * lists, run against the mock backend so that no X server is needed.
+ *
+ * Each operation is timed on its own with a workspace holding SIZE clients
+ * (or, for workspace_to_index, with SIZE workspaces). The result of each is
+ * printed as a JSON object on its own line, in a fixed order:
+ *
+ *	{"op":"loc_win","size":1000,"iterations":10,"ns_per_op":2134,
+ *	 "requests_per_op":0.0}
+ *
+ * requests_per_op is the amount of X requests made by each call, which is
+ * exact and so can be compared between commits without any noise.
+ *
+ * Usage: microbench [SIZE...]
+ */
+
+/** The window ID of the first fake client. */
+#define WIN_BASE 0x400000
+/** Roughly how many client visits each benchmark is allowed, this is divided
+ * by SIZE to give the amount of iterations. */
+#define WORK_BUDGET 10000
+#define MAX_ITERATIONS 1000
+
+/** The time and requests spent in one benchmark. */
+struct result {
+	const char *op; /**< The operation being measured. */
+	unsigned int size; /**< The amount of clients or workspaces. */
+	unsigned int iterations; /**< How many times op was run. */
+	uint64_t ns; /**< The total time spent in op. */
+	unsigned long requests; /**< The total X requests made by op. */
+};
+
+/** Run stmt, adding the time it takes and the requests it makes to r. */
+#define TIMED(r, stmt) \
+	do { \
+		uint64_t start; \
+		configure_commit(); \
+		mock_reset(); \
+		start = now_ns(); \
+		stmt; \
+		configure_commit(); \
+		(r)->ns += now_ns() - start; \
+		(r)->requests += mock_request_cnt(); \
+	} while (0)
+
+static unsigned int next_win = WIN_BASE;
+/** Where results are written. howm prints its status to stdout, so that is
+ * redirected to /dev/null while benchmarking. */
+static FILE *out;
+
+/**
+ * @brief The current time, from a clock that is never adjusted.
+ *
+ * @return The time in nanoseconds.
+ */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Find the last client on a workspace.
+ *
+ * @param ws The workspace to search.
+ *
+ * @return The last client, or NULL if there are none.
+ */
+static client_t *last_client(workspace_t *ws)
+{
+	client_t *c = ws->head;
+
+	while (c && c->next)
+		c = c->next;
+	return c;
+}
+
+/**
+ * @brief Add clients to a workspace and focus the last one.
+ *
+ * @param ws The workspace, which must be the current one.
+ * @param n How many clients to add.
+ */
+static void fill_ws(workspace_t *ws, unsigned int n)
+{
+	while (n-- > 0)
+		create_client(next_win++);
+	ws->c = last_client(ws);
+}
+
+/**
+ * @brief Remove every client from a workspace.
+ *
+ * @param ws The workspace to be emptied.
+ */
+static void empty_ws(workspace_t *ws)
+{
+	ws->c = ws->prev_foc = NULL;
+	while (ws->head)
+		remove_client(mon, ws, ws->head);
+}
+
+/**
+ * @brief Move the first client of a workspace to the end of its list,
+ * without touching the X server.
+ *
+ * @param ws The workspace.
+ */
+static void head_to_tail(workspace_t *ws)
+{
+	client_t *c = ws->head;
+
+	if (!c || !c->next)
+		return;
+	ws->head = c->next;
+	last_client(ws)->next = c;
+	c->next = NULL;
+}
+
+static void bench_create_client(struct result *r)
+{
+	client_t *c;
+	unsigned int i;
+
+	fill_ws(mon->ws, r->size);
+	for (i = 0; i < r->iterations; i++) {
+		TIMED(r, c = create_client(next_win++));
+		remove_client(mon, mon->ws, c);
+	}
+	empty_ws(mon->ws);
+}
+
+static void bench_remove_client(struct result *r)
+{
+	client_t *c;
+	unsigned int i;
+
+	fill_ws(mon->ws, r->size);
+	for (i = 0; i < r->iterations; i++) {
+		c = create_client(next_win++);
+		TIMED(r, remove_client(mon, mon->ws, c));
+	}
+	empty_ws(mon->ws);
+}
+
+static void bench_prev_client(struct result *r)
+{
+	client_t *last;
+	unsigned int i;
+
+	fill_ws(mon->ws, r->size);
+	last = last_client(mon->ws);
+	for (i = 0; i < r->iterations; i++)
+		TIMED(r, prev_client(last, mon->ws));
+	empty_ws(mon->ws);
+}
+
+static void bench_move_client(struct result *r)
+{
+	unsigned int i;
+
+	fill_ws(mon->ws, r->size);
+	/* Move the last client up and back down again. */
+	for (i = 0; i < r->iterations; i++)
+		TIMED(r, move_client(1, i % 2 == 0));
+	empty_ws(mon->ws);
+}
+
+static void bench_make_master(struct result *r)
+{
+	unsigned int i;
+
+	fill_ws(mon->ws, r->size);
+	for (i = 0; i < r->iterations; i++) {
+		mon->ws->c = last_client(mon->ws);
+		TIMED(r, make_master());
+		head_to_tail(mon->ws);
+	}
+	empty_ws(mon->ws);
+}
+
+static void bench_client_to_ws(struct result *r)
+{
+	workspace_t *dst = mon->ws->next;
+	client_t *c;
+	unsigned int i;
+
+	change_ws(dst);
+	fill_ws(dst, r->size);
+	change_ws(mon->ws_head);
+	fill_ws(mon->ws, r->size);
+	for (i = 0; i < r->iterations; i++) {
+		c = last_client(mon->ws);
+		TIMED(r, client_to_ws(c, dst, false));
+		detach_client(mon, dst, c);
+		attach_client(mon->ws, c);
+	}
+	empty_ws(mon->ws);
+	empty_ws(dst);
+}
+
+static void bench_loc_win(struct result *r)
+{
+	location_t loc;
+	unsigned int i;
+
+	fill_ws(mon->ws, r->size);
+	for (i = 0; i < r->iterations; i++)
+		TIMED(r, loc_win(&loc, next_win - 1));
+	empty_ws(mon->ws);
+}
+
+static void bench_workspace_to_index(struct result *r)
+{
+	unsigned int i, nr_ws = mon->workspace_cnt;
+
+	for (i = nr_ws; i < r->size; i++)
+		add_ws(mon);
+	for (i = 0; i < r->iterations; i++)
+		TIMED(r, workspace_to_index(mon->ws_tail));
+	while (mon->workspace_cnt > nr_ws)
+		remove_ws(mon, mon->ws_tail);
+}
+
+static void bench_paste(struct result *r)
+{
+	unsigned int i;
+
+	fill_ws(mon->ws, r->size);
+	for (i = 0; i < r->iterations; i++) {
+		mon->ws->c = last_client(mon->ws);
+		op_cut(CLIENT, 1);
+		TIMED(r, paste());
+	}
+	empty_ws(mon->ws);
+}
+
+static const struct {
+	const char *name;
+	void (*run)(struct result *r);
+} benches[] = {
+	{ "create_client", bench_create_client },
+	{ "remove_client", bench_remove_client },
+	{ "prev_client", bench_prev_client },
+	{ "move_client", bench_move_client },
+	{ "make_master", bench_make_master },
+	{ "client_to_ws", bench_client_to_ws },
+	{ "loc_win", bench_loc_win },
+	{ "workspace_to_index", bench_workspace_to_index },
+	{ "paste", bench_paste },
+};
+
+/**
+ * @brief Print the result of a benchmark as a single line of JSON.
+ *
+ * @param r The result.
+ */
+static void report(const struct result *r)
+{
+	fprintf(out, "{\"op\":\"%s\",\"size\":%u,\"iterations\":%u,"
+		"\"ns_per_op\":%llu,\"requests_per_op\":%.1f}\n",
+		r->op, r->size, r->iterations,
+		(unsigned long long)(r->ns / r->iterations),
+		(double)r->requests / r->iterations);
+	fflush(out);
+}
+
+int main(int argc, char *argv[])
+{
+	static const unsigned int def_sizes[] = { 10, 100, 1000, 10000 };
+	struct result r;
+	unsigned int i, s, nr_sizes;
+	unsigned int *sizes;
+
+	nr_sizes = argc > 1 ? (unsigned int)argc - 1 : LENGTH(def_sizes);
+	sizes = calloc(nr_sizes, sizeof(*sizes));
+	if (!sizes) {
+		fprintf(stderr, "microbench: out of memory\n");
+		return EXIT_FAILURE;
+	}
+	for (s = 0; s < nr_sizes; s++) {
+		sizes[s] = argc > 1 ? (unsigned int)atoi(argv[s + 1])
+			: def_sizes[s];
+		if (sizes[s] < 2) {
+			fprintf(stderr, "usage: %s [SIZE...], each SIZE >= 2\n",
+				argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	out = fdopen(dup(STDOUT_FILENO), "w");
+	if (!out || !freopen("/dev/null", "w", stdout)) {
+		fprintf(stderr, "microbench: can't redirect stdout\n");
+		return EXIT_FAILURE;
+	}
+
+	log_set_level(NULL, LOG_NONE);
+	mock_backend_init(1920, 1080);
+	mock_set_discard(true);
+	add_ws(mon);
+
+	for (i = 0; i < LENGTH(benches); i++) {
+		for (s = 0; s < nr_sizes; s++) {
+			r = (struct result) { benches[i].name, sizes[s], 0, 0, 0 };
+			r.iterations = WORK_BUDGET / sizes[s];
+			if (r.iterations < 1)
+				r.iterations = 1;
+			else if (r.iterations > MAX_ITERATIONS)
+				r.iterations = MAX_ITERATIONS;
+			benches[i].run(&r);
+			report(&r);
+		}
+	}
+
+	free(sizes);
+	fclose(out);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#!/bin/sh
+#
+# Run howm's benchmarks against a headless X server.
+#
+# For each client count in BENCH_SIZES, a fresh Xvfb and howm are started and
+# xbench is run against them. Results are printed to stdout as one JSON object
+# per line, everything else goes to stderr.
+#
+# Environment:
+#   HOWM             The howm binary to benchmark (default: ./howm).
+#   XBENCH           The xbench binary (default: bin/release/xbench).
+#   BENCH_SIZES      The client counts to test (default: "10 100 1000").
+#   BENCH_ITERATIONS Samples per metric, where repeatable (default: 100).
+
+HOWM=${HOWM:-./howm}
+XBENCH=${XBENCH:-bin/release/xbench}
+BENCH_SIZES=${BENCH_SIZES:-"10 100 1000"}
+BENCH_ITERATIONS=${BENCH_ITERATIONS:-100}
+CONF=$(dirname "$0")/howmrc
+
+if ! command -v Xvfb > /dev/null; then
+	echo "Xvfb is needed to run the benchmarks." >&2
+	exit 1
+fi
+
+tmp=$(mktemp -d)
+xvfb_pid=
+howm_pid=
+
+stop() {
+	[ -n "$howm_pid" ] && kill "$howm_pid" 2> /dev/null && wait "$howm_pid"
+	[ -n "$xvfb_pid" ] && kill "$xvfb_pid" 2> /dev/null && wait "$xvfb_pid"
+	howm_pid=
+	xvfb_pid=
+}
+
+trap 'stop; rm -rf "$tmp"' EXIT INT TERM
+
+# Wait up to five seconds for a condition to become true.
+wait_for() {
+	i=0
+	while ! eval "$1"; do
+		i=$((i + 1))
+		[ $i -gt 50 ] && return 1
+		sleep 0.1
+	done
+}
+
+status=0
+for n in $BENCH_SIZES; do
+	rm -f "$tmp/display" "$tmp/sock"
+	Xvfb -displayfd 3 -screen 0 1920x1080x24 -nolisten tcp \
+		3> "$tmp/display" 2> "$tmp/xvfb.log" &
+	xvfb_pid=$!
+	if ! wait_for '[ -s "$tmp/display" ]'; then
+		echo "Xvfb failed to start, see below:" >&2
+		cat "$tmp/xvfb.log" >&2
+		exit 1
+	fi
+	display=:$(cat "$tmp/display")
+
+	DISPLAY=$display HOWM_SOCK=$tmp/sock "$HOWM" -c "$CONF" \
+		> /dev/null 2> "$tmp/howm.log" &
+	howm_pid=$!
+	if ! wait_for '[ -S "$tmp/sock" ]'; then
+		echo "howm failed to start, see below:" >&2
+		cat "$tmp/howm.log" >&2
+		exit 1
+	fi
+
+	echo "Benchmarking $n clients on $display" >&2
+	DISPLAY=$display HOWM_SOCK=$tmp/sock "$XBENCH" "$n" "$BENCH_ITERATIONS" \
+		|| status=1
+	stop
+done
+
+exit $status
@@ -0,0 +1,379 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+
+/**
+ * @file xbench.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief A synthetic X client that drives a running instance of howm and
+ * measures how long it takes to respond.
+ *
+ * The following are measured, each is printed as a JSON object on its own
+ * line:
+ *
+ * - map_to_configured: From mapping a window until howm has configured and
+ *   mapped it.
+ * - focus_cycle: From sending focus_next_client until the next window gets a
+ *   FocusIn event.
+ * - workspace_switch: From sending change_ws until every window has been
+ *   unmapped (or mapped, when switching back).
+ * - ipc_round_trip: From connecting to howm's socket until the reply to an
+ *   unknown command has been read.
+ *
+ * Usage: xbench CLIENTS [ITERATIONS]
+ */
+
+/** The socket howm uses when HOWM_SOCK isn't set. Keep in sync with howm.h. */
+#define DEF_SOCK_PATH "/tmp/howm"
+/** Mirrors MSG_FUNCTION in ipc.h. */
+#define MSG_FUNCTION 1
+/** How long to wait for an event before giving up. */
+#define EVENT_TIMEOUT_MS 10000
+
+/** A set of latency samples, in microseconds. */
+struct samples {
+	const char *metric; /**< The name the samples are reported under. */
+	uint64_t *us; /**< The samples. */
+	unsigned int cnt; /**< The amount of samples taken. */
+};
+
+static xcb_connection_t *dpy;
+static xcb_window_t *wins;
+static unsigned int nr_wins;
+static const char *sock_path = DEF_SOCK_PATH;
+
+/**
+ * @brief The current time, from a clock that is never adjusted.
+ *
+ * @return The time in microseconds.
+ */
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Send a function call to howm and wait for its reply.
+ *
+ * @param func The name of the function to be called.
+ * @param arg An optional argument, or NULL.
+ *
+ * @return The error code returned by howm, or -1 if howm couldn't be reached.
+ */
+static int ipc_call(const char *func, const char *arg)
+{
+	struct sockaddr_un addr;
+	char msg[256];
+	int fd, ret = -1;
+	size_t len = 0;
+
+	msg[len++] = MSG_FUNCTION;
+	msg[len++] = '\0';
+	len += snprintf(msg + len, sizeof(msg) - len, "%s", func) + 1;
+	if (arg)
+		len += snprintf(msg + len, sizeof(msg) - len, "%s", arg) + 1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sock_path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1)
+		return -1;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0
+			&& write(fd, msg, len) == (ssize_t)len
+			&& read(fd, &ret, sizeof(ret)) != sizeof(ret))
+		ret = -1;
+	close(fd);
+	return ret;
+}
+
+/**
+ * @brief Wait for the next event from the X server.
+ *
+ * @return The event, which must be freed, or NULL on timeout.
+ */
+static xcb_generic_event_t *wait_event(void)
+{
+	struct pollfd pfd = { xcb_get_file_descriptor(dpy), POLLIN, 0 };
+	xcb_generic_event_t *ev;
+
+	while (!(ev = xcb_poll_for_event(dpy))) {
+		if (xcb_connection_has_error(dpy)
+				|| poll(&pfd, 1, EVENT_TIMEOUT_MS) <= 0)
+			return NULL;
+	}
+	return ev;
+}
+
+/**
+ * @brief Discard any events that have already arrived.
+ */
+static void drain_events(void)
+{
+	xcb_generic_event_t *ev;
+
+	xcb_flush(dpy);
+	while ((ev = xcb_poll_for_event(dpy)) != NULL)
+		free(ev);
+}
+
+/**
+ * @brief Wait until a given amount of events of one type have arrived.
+ *
+ * @param type The response type to count.
+ * @param cnt How many events are needed.
+ *
+ * @return True if they all arrived before a timeout.
+ */
+static bool wait_events(uint8_t type, unsigned int cnt)
+{
+	xcb_generic_event_t *ev;
+	bool match;
+
+	while (cnt > 0) {
+		ev = wait_event();
+		if (!ev)
+			return false;
+		match = (ev->response_type & ~0x80) == type;
+		/* Focus moving to the pointer's window isn't ours. */
+		if (match && type == XCB_FOCUS_IN)
+			match = ((xcb_focus_in_event_t *)ev)->detail
+				!= XCB_NOTIFY_DETAIL_POINTER;
+		if (match)
+			cnt--;
+		free(ev);
+	}
+	return true;
+}
+
+/**
+ * @brief Create the windows and map them one at a time.
+ *
+ * @param s Where to store the map latency of each window.
+ *
+ * @return True on success.
+ */
+static bool bench_map(struct samples *s)
+{
+	xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(dpy)).data;
+	uint32_t mask[] = { XCB_EVENT_MASK_STRUCTURE_NOTIFY
+			    | XCB_EVENT_MASK_FOCUS_CHANGE };
+	xcb_generic_event_t *ev;
+	uint64_t start;
+	unsigned int i;
+
+	for (i = 0; i < nr_wins; i++) {
+		wins[i] = xcb_generate_id(dpy);
+		xcb_create_window(dpy, XCB_COPY_FROM_PARENT, wins[i], screen->root,
+				  0, 0, 100, 100, 0,
+				  XCB_WINDOW_CLASS_INPUT_OUTPUT,
+				  screen->root_visual, XCB_CW_EVENT_MASK, mask);
+		drain_events();
+
+		start = now_us();
+		xcb_map_window(dpy, wins[i]);
+		xcb_flush(dpy);
+		for (;;) {
+			ev = wait_event();
+			if (!ev)
+				return false;
+			if ((ev->response_type & ~0x80) == XCB_MAP_NOTIFY
+					&& ((xcb_map_notify_event_t *)ev)->window == wins[i]) {
+				free(ev);
+				break;
+			}
+			free(ev);
+		}
+		s->us[s->cnt++] = now_us() - start;
+	}
+	return true;
+}
+
+/**
+ * @brief Cycle focus through the windows.
+ *
+ * @param s Where to store the latency of each focus change.
+ * @param iterations How many times to change focus.
+ *
+ * @return True on success.
+ */
+static bool bench_focus(struct samples *s, unsigned int iterations)
+{
+	uint64_t start;
+
+	while (iterations-- > 0) {
+		drain_events();
+		start = now_us();
+		if (ipc_call("focus_next_client", NULL) < 0
+				|| !wait_events(XCB_FOCUS_IN, 1))
+			return false;
+		s->us[s->cnt++] = now_us() - start;
+	}
+	return true;
+}
+
+/**
+ * @brief Switch to an empty workspace and back again.
+ *
+ * @param s Where to store the latency of each switch.
+ * @param iterations How many times to switch there and back.
+ *
+ * @return True on success.
+ */
+static bool bench_workspace(struct samples *s, unsigned int iterations)
+{
+	uint64_t start;
+
+	while (iterations-- > 0) {
+		drain_events();
+		start = now_us();
+		if (ipc_call("change_ws", "1") < 0
+				|| !wait_events(XCB_UNMAP_NOTIFY, nr_wins))
+			return false;
+		s->us[s->cnt++] = now_us() - start;
+
+		drain_events();
+		start = now_us();
+		if (ipc_call("change_ws", "0") < 0
+				|| !wait_events(XCB_MAP_NOTIFY, nr_wins))
+			return false;
+		s->us[s->cnt++] = now_us() - start;
+	}
+	return true;
+}
+
+/**
+ * @brief Time a command that howm rejects without doing any work.
+ *
+ * @param s Where to store the latency of each round trip.
+ * @param iterations How many commands to send.
+ *
+ * @return True on success.
+ */
+static bool bench_ipc(struct samples *s, unsigned int iterations)
+{
+	uint64_t start;
+
+	while (iterations-- > 0) {
+		start = now_us();
+		if (ipc_call("xbench_nop", NULL) < 0)
+			return false;
+		s->us[s->cnt++] = now_us() - start;
+	}
+	return true;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Print a summary of some samples as a single line of JSON.
+ *
+ * @param s The samples to be summarised. They will be sorted.
+ */
+static void report(struct samples *s)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	if (s->cnt == 0)
+		return;
+	qsort(s->us, s->cnt, sizeof(*s->us), cmp_u64);
+	for (i = 0; i < s->cnt; i++)
+		sum += s->us[i];
+
+#define PCT(p) s->us[(s->cnt - 1) * (p) / 100]
+	printf("{\"clients\":%u,\"metric\":\"%s\",\"samples\":%u,"
+	       "\"min_us\":%llu,\"p50_us\":%llu,\"p90_us\":%llu,"
+	       "\"p99_us\":%llu,\"max_us\":%llu,\"mean_us\":%llu}\n",
+	       nr_wins, s->metric, s->cnt,
+	       (unsigned long long)s->us[0], (unsigned long long)PCT(50),
+	       (unsigned long long)PCT(90), (unsigned long long)PCT(99),
+	       (unsigned long long)s->us[s->cnt - 1],
+	       (unsigned long long)(sum / s->cnt));
+#undef PCT
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int iterations = 100;
+	struct samples map, focus, ws, ipc;
+	bool ok;
+
+	if (argc < 2 || atoi(argv[1]) < 2) {
+		fprintf(stderr, "usage: %s CLIENTS [ITERATIONS]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	nr_wins = atoi(argv[1]);
+	if (argc > 2 && atoi(argv[2]) > 0)
+		iterations = atoi(argv[2]);
+	if (getenv("HOWM_SOCK"))
+		sock_path = getenv("HOWM_SOCK");
+
+	wins = calloc(nr_wins, sizeof(*wins));
+	map = (struct samples) { "map_to_configured", calloc(nr_wins, sizeof(uint64_t)), 0 };
+	focus = (struct samples) { "focus_cycle", calloc(iterations, sizeof(uint64_t)), 0 };
+	ws = (struct samples) { "workspace_switch", calloc(2 * iterations, sizeof(uint64_t)), 0 };
+	ipc = (struct samples) { "ipc_round_trip", calloc(iterations, sizeof(uint64_t)), 0 };
+	if (!wins || !map.us || !focus.us || !ws.us || !ipc.us) {
+		fprintf(stderr, "xbench: out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	dpy = xcb_connect(NULL, NULL);
+	if (xcb_connection_has_error(dpy)) {
+		fprintf(stderr, "xbench: can't open X connection\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Zoom is the only layout that stays valid for any amount of
+	 * clients. */
+	if (ipc_call("change_layout", "0") < 0) {
+		fprintf(stderr, "xbench: can't talk to howm on %s\n", sock_path);
+		return EXIT_FAILURE;
+	}
+
+	ok = bench_map(&map)
+		&& bench_focus(&focus, iterations)
+		&& bench_workspace(&ws, iterations)
+		&& bench_ipc(&ipc, iterations);
+
+	report(&map);
+	report(&focus);
+	report(&ws);
+	report(&ipc);
+
+	if (!ok)
+		fprintf(stderr, "xbench: timed out waiting for howm\n");
+
+	xcb_disconnect(dpy);
+	free(wins);
+	free(map.us);
+	free(focus.us);
+	free(ws.us);
+	free(ipc.us);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,407 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ipc.h"
+
+/**
+ * @file howmc.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief A client for howm that keeps a single connection open, so that many
+ * commands can be sent without connecting for each one.
+ *
+ * A command is given in the same form as to cottage:
+ *
+ *	-f FUNCTION ARGS...
+ *	-c OPTION VALUE
+ *	-q QUERY
+ *
+ * If a command is given on the commandline, it is sent and howmc exits with
+ * howm's error code (or HOWMC_ERR_CONN if howm couldn't be reached).
+ * Otherwise commands are read from stdin (or from a FIFO with -d), one per
+ * line with arguments separated by whitespace.
+ *
+ * Usage: howmc [-l] [-s SOCKET] [-d FIFO] [COMMAND]
+ */
+
+/** The socket howm uses when HOWM_SOCK isn't set. Keep in sync with howm.h. */
+#define DEF_SOCK_PATH "/tmp/howm"
+#define ENV_SOCK_VAR "HOWM_SOCK"
+/** The longest message howm accepts. Keep in sync with howm.h. */
+#define IPC_BUF_SIZE 1024
+/** Arguments are split on these when reading commands as lines. */
+#define ARG_SEPS " \t\n"
+/** The exit status when howm couldn't be reached. */
+#define HOWMC_ERR_CONN 255
+
+/** A description of each of enum ipc_errs. */
+static const char * const err_names[] = {
+	[IPC_ERR_NONE] = "no error",
+	[IPC_ERR_SYNTAX] = "syntax error",
+	[IPC_ERR_ALLOC] = "howm ran out of memory",
+	[IPC_ERR_NO_FUNC] = "no such function",
+	[IPC_ERR_TOO_MANY_ARGS] = "too many arguments",
+	[IPC_ERR_TOO_FEW_ARGS] = "too few arguments",
+	[IPC_ERR_ARG_NOT_INT] = "argument isn't an integer",
+	[IPC_ERR_ARG_NOT_BOOL] = "argument isn't a boolean",
+	[IPC_ERR_ARG_TOO_LARGE] = "argument is too large",
+	[IPC_ERR_ARG_TOO_SMALL] = "argument is too small",
+	[IPC_ERR_UNKNOWN_TYPE] = "unknown message type",
+	[IPC_ERR_NO_CONFIG] = "no such config option",
+	[IPC_ERR_BUSY] = "howm has too many sessions open",
+};
+
+static const char *sock_path = DEF_SOCK_PATH;
+static int sock_fd = -1;
+/** Print the round trip time of each command to stderr. */
+static bool latency;
+
+/**
+ * @brief The current time, from a clock that is never adjusted.
+ *
+ * @return The time in microseconds.
+ */
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Describe an error code from howm.
+ *
+ * @param err The error code.
+ *
+ * @return The description.
+ */
+static const char *err_name(int err)
+{
+	if (err < 0 || err >= (int)(sizeof(err_names) / sizeof(*err_names)))
+		return "unknown error";
+	return err_names[err];
+}
+
+/**
+ * @brief Read exactly len bytes from the socket.
+ *
+ * @param buf Where to store the data.
+ * @param len The amount of data to read.
+ *
+ * @return True if all of the data was read.
+ */
+static bool read_all(void *buf, size_t len)
+{
+	char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = read(sock_fd, p, len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+/**
+ * @brief Write exactly len bytes to the socket.
+ *
+ * @param buf The data to write.
+ * @param len The length of the data.
+ *
+ * @return True if all of the data was written.
+ */
+static bool write_all(const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(sock_fd, p, len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+/**
+ * @brief Connect to howm and start a session, so that the connection stays
+ * open between commands.
+ *
+ * @return True if the session was started.
+ */
+static bool session_open(void)
+{
+	struct sockaddr_un addr;
+	const char start[] = { MSG_SESSION, '\0' };
+	int err;
+
+	sock_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock_fd == -1) {
+		perror("howmc: socket");
+		return false;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sock_path);
+	if (connect(sock_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		fprintf(stderr, "howmc: can't connect to %s: %s\n", sock_path,
+			strerror(errno));
+		goto fail;
+	}
+	if (!write_all(start, sizeof(start)) || !read_all(&err, sizeof(err))) {
+		fprintf(stderr, "howmc: howm closed the connection\n");
+		goto fail;
+	}
+	if (err != IPC_ERR_NONE) {
+		fprintf(stderr, "howmc: %s\n", err_name(err));
+		goto fail;
+	}
+	return true;
+
+fail:
+	close(sock_fd);
+	sock_fd = -1;
+	return false;
+}
+
+/**
+ * @brief Send a message in the current session and wait for the response.
+ *
+ * @param msg The message.
+ * @param len The length of the message.
+ * @param is_query Whether the message is a query, so is followed by text.
+ * @param err Where to store howm's error code.
+ *
+ * @return False if the connection failed.
+ */
+static bool session_send(const char *msg, uint32_t len, bool is_query, int *err)
+{
+	char text[BUFSIZ];
+	uint32_t text_len;
+	size_t n;
+
+	if (!write_all(&len, sizeof(len)) || !write_all(msg, len)
+			|| !read_all(err, sizeof(*err)))
+		return false;
+	if (!is_query)
+		return true;
+	if (!read_all(&text_len, sizeof(text_len)))
+		return false;
+	while (text_len > 0) {
+		n = text_len < sizeof(text) ? text_len : sizeof(text);
+		if (!read_all(text, n))
+			return false;
+		fwrite(text, 1, n, stdout);
+		text_len -= n;
+	}
+	fflush(stdout);
+	return true;
+}
+
+/**
+ * @brief Send a command to howm, reconnecting if howm has gone away (such as
+ * after being restarted).
+ *
+ * @param flag The command's type, one of "-f", "-c" or "-q".
+ * @param args The command's arguments.
+ * @param nr_args The amount of arguments.
+ *
+ * @return The error code from howm, or -1 if it couldn't be sent.
+ */
+static int run_cmd(const char *flag, char **args, int nr_args)
+{
+	char msg[IPC_BUF_SIZE];
+	uint32_t len = 2;
+	size_t arg_len;
+	uint64_t start;
+	int i, err = -1;
+
+	if (strcmp(flag, "-f") == 0)
+		msg[0] = MSG_FUNCTION;
+	else if (strcmp(flag, "-c") == 0)
+		msg[0] = MSG_CONFIG;
+	else if (strcmp(flag, "-q") == 0)
+		msg[0] = MSG_QUERY;
+	else {
+		fprintf(stderr, "howmc: unknown command type %s\n", flag);
+		return -1;
+	}
+	msg[1] = '\0';
+	for (i = 0; i < nr_args; i++) {
+		arg_len = strlen(args[i]) + 1;
+		if (len + arg_len >= sizeof(msg)) {
+			fprintf(stderr, "howmc: command is too long\n");
+			return -1;
+		}
+		memcpy(msg + len, args[i], arg_len);
+		len += arg_len;
+	}
+
+	start = now_us();
+	for (i = 0; i < 2; i++) {
+		if (sock_fd == -1 && !session_open())
+			return -1;
+		if (session_send(msg, len, msg[0] == MSG_QUERY, &err))
+			break;
+		close(sock_fd);
+		sock_fd = -1;
+		err = -1;
+	}
+	if (err == -1) {
+		fprintf(stderr, "howmc: lost the connection to howm\n");
+		return -1;
+	}
+	if (latency)
+		fprintf(stderr, "%s %llu us\n", nr_args > 0 ? args[0] : flag,
+			(unsigned long long)(now_us() - start));
+	if (err > 0)
+		fprintf(stderr, "howmc: %s: %s\n", nr_args > 0 ? args[0] : flag,
+			err_name(err));
+	return err;
+}
+
+/**
+ * @brief Split a line into arguments and run it as a command. Empty lines and
+ * lines starting with '#' are ignored.
+ *
+ * @param line The line, which is modified.
+ *
+ * @return The error code from howm, or -1 if the command couldn't be sent.
+ */
+static int run_line(char *line)
+{
+	char *args[IPC_BUF_SIZE / 2];
+	char *arg;
+	int nr_args = 0;
+
+	for (arg = strtok(line, ARG_SEPS); arg; arg = strtok(NULL, ARG_SEPS)) {
+		if (nr_args == 0 && arg[0] == '#')
+			return 0;
+		if (nr_args == (int)(sizeof(args) / sizeof(*args))) {
+			fprintf(stderr, "howmc: too many arguments\n");
+			return -1;
+		}
+		args[nr_args++] = arg;
+	}
+	if (nr_args == 0)
+		return 0;
+	return run_cmd(args[0], args + 1, nr_args - 1);
+}
+
+/**
+ * @brief Run each line of a file as a command.
+ *
+ * @param f The file.
+ *
+ * @return Zero if every command succeeded, otherwise the error of the last
+ * command that failed.
+ */
+static int run_file(FILE *f)
+{
+	char *line = NULL;
+	size_t cap = 0;
+	int err, ret = 0;
+
+	while (getline(&line, &cap, f) != -1) {
+		err = run_line(line);
+		if (err != 0)
+			ret = err;
+	}
+	free(line);
+	return ret;
+}
+
+/**
+ * @brief Create a FIFO and run every line that is written to it, forever.
+ *
+ * @param path Where the FIFO should be created.
+ *
+ * @return Only returns if the FIFO can't be created or opened.
+ */
+static int run_fifo(const char *path)
+{
+	FILE *f;
+
+	if (mkfifo(path, 0600) == -1 && errno != EEXIST) {
+		fprintf(stderr, "howmc: can't create %s: %s\n", path,
+			strerror(errno));
+		return EXIT_FAILURE;
+	}
+	/* Each time the last writer closes the FIFO, wait for a new one. */
+	while ((f = fopen(path, "r")) != NULL) {
+		run_file(f);
+		fclose(f);
+	}
+	fprintf(stderr, "howmc: can't open %s: %s\n", path, strerror(errno));
+	return EXIT_FAILURE;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-l] [-s SOCKET] [-d FIFO] "
+		"[-f FUNCTION ARGS... | -c OPTION VALUE | -q QUERY]\n", name);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *fifo = NULL;
+	char *sp = getenv(ENV_SOCK_VAR);
+	int i, ret;
+
+	if (sp)
+		sock_path = sp;
+	/* Reconnecting is handled by run_cmd(). */
+	signal(SIGPIPE, SIG_IGN);
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-l") == 0)
+			latency = true;
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			sock_path = argv[++i];
+		else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+			fifo = argv[++i];
+		else if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "-c") == 0
+				|| strcmp(argv[i], "-q") == 0)
+			break;
+		else
+			usage(argv[0]);
+	}
+
+	if (i < argc)
+		ret = run_cmd(argv[i], argv + i + 1, argc - i - 1);
+	else if (fifo)
+		ret = run_fifo(fifo);
+	else
+		ret = run_file(stdin);
+
+	if (sock_fd != -1)
+		close(sock_fd);
+	/* Keep failures to reach howm apart from howm's own error codes. */
+	return ret == -1 ? HOWMC_ERR_CONN : ret;
+}
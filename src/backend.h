@@ -0,0 +1,116 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <xcb/xcb.h>
+#include <xcb/xcb_ewmh.h>
+#include <xcb/xproto.h>
+
+/**
+ * @file backend.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/**
+ * @brief What howm needs to know about a window before managing it.
+ */
+struct xwin_info {
+	bool override_redirect; /**< The window doesn't want to be managed. */
+	bool is_dock; /**< A dock or toolbar, which is mapped but not managed. */
+	bool wants_float; /**< A dialog, menu, splash or notification. */
+	xcb_window_t transient_for; /**< The window this is transient for, or
+				      XCB_NONE. */
+	bool has_geom; /**< Whether geom could be fetched. */
+	xcb_rectangle_t geom; /**< The window's initial geometry. */
+	uint32_t pid; /**< The window's _NET_WM_PID, or 0 if unset. */
+};
+
+/**
+ * @brief The X requests that howm makes once it is running.
+ *
+ * Each of these maps onto a single X request (or, for the queries, a batch
+ * of requests whose replies are waited on together). Setup, such as
+ * interning atoms and querying RandR, always talks to the X server directly.
+ *
+ * The keyboard mapping is cached by the backend, so translating between
+ * keysyms and keycodes only makes a request after the mapping has been
+ * refreshed. keysym_to_keycodes() returns an array terminated by
+ * XCB_NO_SYMBOL, which must be freed.
+ *
+ * create_window() makes an override redirect window for howm to draw in,
+ * which reports exposures and button presses. draw_label() fills a rectangle
+ * of such a window and writes text over it in the core font TAB_FONT,
+ * clipped to the rectangle. get_title() stores a window's title as
+ * printable ASCII, truncated to fit len.
+ *
+ * Mapping, unmapping, configuring and warping can move a window under the
+ * pointer. mark_layout() follows any such requests with a request that has
+ * no effect, and layout_seq() returns that marker's sequence number. Every
+ * crossing caused by the earlier requests has a full_sequence before the
+ * marker's, while a crossing that happens after they were all processed has
+ * one at or after it. flush() marks before flushing, and the main loop marks
+ * after committing queued configures.
+ */
+struct xbackend {
+	const char *name; /**< The name of the backend. */
+	void (*map_window)(xcb_window_t win);
+	void (*unmap_window)(xcb_window_t win);
+	void (*configure_window)(xcb_window_t win, uint16_t mask,
+				 const uint32_t *vals);
+	void (*change_window_attributes)(xcb_window_t win, uint32_t mask,
+					 const uint32_t *vals);
+	void (*change_property)(xcb_window_t win, xcb_atom_t prop,
+				xcb_atom_t type, uint32_t len,
+				const uint32_t *data);
+	void (*set_input_focus)(xcb_window_t win);
+	void (*grab_button)(xcb_window_t win, uint8_t pointer_mode);
+	void (*ungrab_button)(xcb_window_t win);
+	void (*grab_mouse)(xcb_window_t win, uint16_t mods, uint8_t button);
+	void (*allow_events)(xcb_timestamp_t time);
+	void (*kill_client)(xcb_window_t win);
+	void (*send_event)(xcb_window_t win,
+			   const xcb_client_message_event_t *ev);
+	void (*warp_pointer)(int16_t x, int16_t y);
+	void (*set_active_window)(xcb_window_t win);
+	void (*set_current_desktop)(uint32_t desktop);
+	void (*set_number_of_desktops)(uint32_t cnt);
+	void (*set_workarea)(uint32_t len, xcb_ewmh_geometry_t *workarea);
+	void (*set_frame_extents)(xcb_window_t win, uint32_t space);
+	bool (*get_window_info)(xcb_window_t win, struct xwin_info *info);
+	bool (*supports_delete)(xcb_window_t win);
+	void (*grab_key)(xcb_window_t win, uint16_t mods, xcb_keycode_t code);
+	void (*ungrab_keys)(xcb_window_t win);
+	xcb_keycode_t *(*keysym_to_keycodes)(xcb_keysym_t sym);
+	xcb_keysym_t (*keycode_to_keysym)(xcb_keycode_t code);
+	void (*refresh_keymap)(xcb_mapping_notify_event_t *ev);
+	xcb_window_t (*create_window)(xcb_rectangle_t rect, uint32_t bg);
+	void (*destroy_window)(xcb_window_t win);
+	void (*draw_label)(xcb_window_t win, uint32_t fg, uint32_t bg,
+			   xcb_rectangle_t rect, const char *text);
+	bool (*get_title)(xcb_window_t win, char *buf, size_t len);
+	void (*mark_layout)(void);
+	uint32_t (*layout_seq)(void);
+	void (*flush)(void);
+};
+
+/** The backend in use, requests should only be made through this. */
+extern const struct xbackend *xb;
+extern const struct xbackend xcb_backend;
+extern const struct xbackend mock_backend;
+
+void mock_backend_init(uint16_t width, uint16_t height);
+void mock_set_window_info(xcb_window_t win, const struct xwin_info *info);
+void mock_print(FILE *f);
+unsigned long mock_request_cnt(void);
+unsigned long mock_count(const char *op, uint32_t mask);
+void mock_set_discard(bool only_count);
+void mock_reset(void);
+
+#endif
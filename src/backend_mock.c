@@ -0,0 +1,505 @@
+#define LOG_SUBSYS LOG_CORE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+#include <xcb/xcb_ewmh.h>
+
+#include "backend.h"
+#include "helper.h"
+#include "howm.h"
+#include "monitor.h"
+#include "scratchpad.h"
+#include "workspace.h"
+#include "xcb_help.h"
+
+/**
+ * @file backend_mock.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief A backend that doesn't need an X server. Each request is recorded in
+ * memory, so that the exact requests made by a command or event can be
+ * inspected.
+ */
+
+/** The root window of the fake screen. */
+#define MOCK_ROOT 0x1
+/** The windows that howm creates are numbered from here. */
+#define MOCK_HOWM_WIN_BASE 0x1000000
+/** The most values that are recorded for a single request. */
+#define MOCK_MAX_VALS 15
+
+/**
+ * @brief A single recorded request.
+ */
+struct mock_req {
+	const char *op; /**< The name of the backend operation. */
+	xcb_window_t win; /**< The window it acted on, or XCB_NONE. */
+	uint32_t mask; /**< The value mask, if the request has one. */
+	unsigned int nr_vals; /**< How many values are stored in vals. */
+	uint32_t vals[MOCK_MAX_VALS]; /**< The request's values. */
+};
+
+/**
+ * @brief The answer to give when howm asks about a window.
+ */
+struct mock_win {
+	xcb_window_t win;
+	struct xwin_info info;
+};
+
+static struct mock_req *reqs;
+static unsigned long nr_reqs, cap_reqs;
+/** A sequence number for each request, which unlike nr_reqs is never reset. */
+static uint32_t seq, layout_seq;
+/** A request that could move a window has been made since the last marker. */
+static bool layout_dirty;
+/** Only count requests, rather than storing them. */
+static bool discard;
+static struct mock_win *wins;
+static unsigned int nr_wins;
+/** The last window created by howm, these start above any client's ID. */
+static xcb_window_t last_win = MOCK_HOWM_WIN_BASE;
+
+static xcb_screen_t mock_screen;
+static xcb_ewmh_connection_t mock_ewmh;
+
+/**
+ * @brief Record a request.
+ *
+ * @param op The name of the operation.
+ * @param win The window that was acted on.
+ * @param mask The request's value mask.
+ * @param nr_vals The amount of values.
+ * @param vals The values, may be NULL if nr_vals is 0.
+ */
+static void record(const char *op, xcb_window_t win, uint32_t mask,
+		unsigned int nr_vals, const uint32_t *vals)
+{
+	struct mock_req *r;
+
+	seq++;
+	if (discard) {
+		nr_reqs++;
+		return;
+	}
+	if (nr_reqs == cap_reqs) {
+		cap_reqs = cap_reqs ? cap_reqs * 2 : 64;
+		reqs = realloc(reqs, cap_reqs * sizeof(*reqs));
+		if (!reqs) {
+			log_err("Can't allocate memory for mock requests");
+			exit(EXIT_FAILURE);
+		}
+	}
+	r = &reqs[nr_reqs++];
+	r->op = op;
+	r->win = win;
+	r->mask = mask;
+	r->nr_vals = nr_vals < MOCK_MAX_VALS ? nr_vals : MOCK_MAX_VALS;
+	if (r->nr_vals)
+		memcpy(r->vals, vals, r->nr_vals * sizeof(*vals));
+}
+
+/**
+ * @brief Count the values that follow a value mask.
+ *
+ * @param mask The value mask of a request.
+ *
+ * @return The amount of bits set in mask.
+ */
+static unsigned int mask_vals(uint32_t mask)
+{
+	unsigned int n = 0;
+
+	for (; mask; mask &= mask - 1)
+		n++;
+	return n;
+}
+
+static void mock_map(xcb_window_t win)
+{
+	record("map_window", win, 0, 0, NULL);
+	layout_dirty = true;
+}
+
+static void mock_unmap(xcb_window_t win)
+{
+	record("unmap_window", win, 0, 0, NULL);
+	layout_dirty = true;
+}
+
+static void mock_configure(xcb_window_t win, uint16_t mask, const uint32_t *vals)
+{
+	record("configure_window", win, mask, mask_vals(mask), vals);
+	layout_dirty = true;
+}
+
+static void mock_change_attributes(xcb_window_t win, uint32_t mask,
+		const uint32_t *vals)
+{
+	record("change_window_attributes", win, mask, mask_vals(mask), vals);
+}
+
+static void mock_change_property(xcb_window_t win, xcb_atom_t prop,
+		xcb_atom_t type, uint32_t len, const uint32_t *data)
+{
+	UNUSED(type);
+	record("change_property", win, prop, len, data);
+}
+
+static void mock_focus(xcb_window_t win)
+{
+	record("set_input_focus", win, 0, 0, NULL);
+}
+
+static void mock_grab(xcb_window_t win, uint8_t pointer_mode)
+{
+	uint32_t mode = pointer_mode;
+
+	record("grab_button", win, 0, 1, &mode);
+}
+
+static void mock_ungrab(xcb_window_t win)
+{
+	record("ungrab_button", win, 0, 0, NULL);
+}
+
+static void mock_grab_mouse(xcb_window_t win, uint16_t mods, uint8_t button)
+{
+	uint32_t b = button;
+
+	record("grab_mouse", win, mods, 1, &b);
+}
+
+static void mock_allow(xcb_timestamp_t time)
+{
+	record("allow_events", XCB_NONE, 0, 1, &time);
+}
+
+static void mock_kill(xcb_window_t win)
+{
+	record("kill_client", win, 0, 0, NULL);
+}
+
+static void mock_send(xcb_window_t win, const xcb_client_message_event_t *ev)
+{
+	record("send_event", win, ev->type, 2, ev->data.data32);
+}
+
+static void mock_warp(int16_t x, int16_t y)
+{
+	uint32_t pos[] = { x, y };
+
+	record("warp_pointer", MOCK_ROOT, 0, LENGTH(pos), pos);
+	layout_dirty = true;
+}
+
+static void mock_active_window(xcb_window_t win)
+{
+	record("set_active_window", win, 0, 0, NULL);
+}
+
+static void mock_current_desktop(uint32_t desktop)
+{
+	record("set_current_desktop", XCB_NONE, 0, 1, &desktop);
+}
+
+static void mock_number_of_desktops(uint32_t cnt)
+{
+	record("set_number_of_desktops", XCB_NONE, 0, 1, &cnt);
+}
+
+static void mock_workarea(uint32_t len, xcb_ewmh_geometry_t *workarea)
+{
+	uint32_t area[4];
+
+	if (len < 1)
+		return;
+	area[0] = workarea->x;
+	area[1] = workarea->y;
+	area[2] = workarea->width;
+	area[3] = workarea->height;
+	record("set_workarea", XCB_NONE, 0, LENGTH(area), area);
+}
+
+static void mock_frame_extents(xcb_window_t win, uint32_t space)
+{
+	record("set_frame_extents", win, 0, 1, &space);
+}
+
+static bool mock_window_info(xcb_window_t win, struct xwin_info *info)
+{
+	unsigned int i;
+
+	record("get_window_info", win, 0, 0, NULL);
+	memset(info, 0, sizeof(*info));
+	for (i = 0; i < nr_wins; i++)
+		if (wins[i].win == win)
+			*info = wins[i].info;
+	return true;
+}
+
+static bool mock_supports_delete(xcb_window_t win)
+{
+	record("supports_delete", win, 0, 0, NULL);
+	return true;
+}
+
+static void mock_grab_key(xcb_window_t win, uint16_t mods, xcb_keycode_t code)
+{
+	uint32_t key = code;
+
+	record("grab_key", win, mods, 1, &key);
+}
+
+static void mock_ungrab_keys(xcb_window_t win)
+{
+	record("ungrab_keys", win, 0, 0, NULL);
+}
+
+/* The fake keyboard has a key for each keysym whose low byte is the keycode.
+ * That is enough for the keysyms that are ASCII characters. */
+static xcb_keycode_t *mock_keysym_to_keycodes(xcb_keysym_t sym)
+{
+	xcb_keycode_t *codes = calloc(2, sizeof(*codes));
+
+	if (!codes) {
+		log_err("Can't allocate memory for mock keycodes");
+		exit(EXIT_FAILURE);
+	}
+	codes[0] = sym & 0xff;
+	codes[1] = XCB_NO_SYMBOL;
+	return codes;
+}
+
+static xcb_keysym_t mock_keycode_to_keysym(xcb_keycode_t code)
+{
+	return code;
+}
+
+static void mock_refresh_keymap(xcb_mapping_notify_event_t *ev)
+{
+	UNUSED(ev);
+}
+
+static xcb_window_t mock_create_window(xcb_rectangle_t rect, uint32_t bg)
+{
+	uint32_t vals[] = { rect.x, rect.y, rect.width, rect.height };
+
+	record("create_window", ++last_win, bg, LENGTH(vals), vals);
+	return last_win;
+}
+
+static void mock_destroy_window(xcb_window_t win)
+{
+	record("destroy_window", win, 0, 0, NULL);
+}
+
+static void mock_draw_label(xcb_window_t win, uint32_t fg, uint32_t bg,
+			    xcb_rectangle_t rect, const char *text)
+{
+	uint32_t vals[] = { rect.x, rect.y, rect.width, rect.height, bg };
+
+	UNUSED(text);
+	record("draw_label", win, fg, LENGTH(vals), vals);
+}
+
+/* Every window is titled with its ID. */
+static bool mock_get_title(xcb_window_t win, char *buf, size_t len)
+{
+	record("get_title", win, 0, 0, NULL);
+	snprintf(buf, len, "0x%x", win);
+	return true;
+}
+
+static void mock_mark_layout(void)
+{
+	if (!layout_dirty)
+		return;
+	record("no_operation", XCB_NONE, 0, 0, NULL);
+	layout_seq = seq;
+	layout_dirty = false;
+}
+
+static uint32_t mock_layout_seq(void)
+{
+	return layout_seq;
+}
+
+static void mock_flush(void)
+{
+	mock_mark_layout();
+}
+
+const struct xbackend mock_backend = {
+	.name = "mock",
+	.map_window = mock_map,
+	.unmap_window = mock_unmap,
+	.configure_window = mock_configure,
+	.change_window_attributes = mock_change_attributes,
+	.change_property = mock_change_property,
+	.set_input_focus = mock_focus,
+	.grab_button = mock_grab,
+	.ungrab_button = mock_ungrab,
+	.grab_mouse = mock_grab_mouse,
+	.allow_events = mock_allow,
+	.kill_client = mock_kill,
+	.send_event = mock_send,
+	.warp_pointer = mock_warp,
+	.set_active_window = mock_active_window,
+	.set_current_desktop = mock_current_desktop,
+	.set_number_of_desktops = mock_number_of_desktops,
+	.set_workarea = mock_workarea,
+	.set_frame_extents = mock_frame_extents,
+	.get_window_info = mock_window_info,
+	.supports_delete = mock_supports_delete,
+	.grab_key = mock_grab_key,
+	.ungrab_keys = mock_ungrab_keys,
+	.keysym_to_keycodes = mock_keysym_to_keycodes,
+	.keycode_to_keysym = mock_keycode_to_keysym,
+	.refresh_keymap = mock_refresh_keymap,
+	.create_window = mock_create_window,
+	.destroy_window = mock_destroy_window,
+	.draw_label = mock_draw_label,
+	.get_title = mock_get_title,
+	.mark_layout = mock_mark_layout,
+	.layout_seq = mock_layout_seq,
+	.flush = mock_flush,
+};
+
+/**
+ * @brief Run howm against the mock backend, with a single monitor.
+ *
+ * The screen and EWMH atoms are faked, so this must be called instead of
+ * connecting to an X server.
+ *
+ * @param width The width of the fake screen.
+ * @param height The height of the fake screen.
+ */
+void mock_backend_init(uint16_t width, uint16_t height)
+{
+	monitor_t *m;
+	xcb_atom_t atom = 0x100;
+
+	xb = &mock_backend;
+
+	mock_screen.root = MOCK_ROOT;
+	mock_screen.width_in_pixels = screen_width = width;
+	mock_screen.height_in_pixels = screen_height = height;
+	screen = &mock_screen;
+
+	/* Only the atoms that are compared against after setup are needed. */
+	mock_ewmh._NET_WM_STATE = atom++;
+	mock_ewmh._NET_WM_STATE_FULLSCREEN = atom++;
+	mock_ewmh._NET_WM_STATE_DEMANDS_ATTENTION = atom++;
+	mock_ewmh._NET_WM_STATE_STICKY = atom++;
+	mock_ewmh._NET_CLOSE_WINDOW = atom++;
+	mock_ewmh._NET_ACTIVE_WINDOW = atom++;
+	mock_ewmh._NET_CURRENT_DESKTOP = atom++;
+	mock_ewmh._NET_WM_NAME = atom++;
+	ewmh = &mock_ewmh;
+	wm_atoms[WM_DELETE_WINDOW] = atom++;
+	wm_atoms[WM_PROTOCOLS] = atom++;
+	wm_atoms[NET_WM_BYPASS_COMPOSITOR] = atom++;
+
+	m = create_monitor((xcb_rectangle_t) { 0, 0, width, height });
+	add_ws(m);
+	stack_init(&del_reg, conf.delete_register_size);
+}
+
+/**
+ * @brief Set what the mock backend reports about a window. Windows that
+ * haven't been set are reported as normal, managed windows.
+ *
+ * @param win The window.
+ * @param info What to report about it.
+ */
+void mock_set_window_info(xcb_window_t win, const struct xwin_info *info)
+{
+	struct mock_win *w = realloc(wins, (nr_wins + 1) * sizeof(*wins));
+
+	if (!w) {
+		log_err("Can't allocate memory for mock window");
+		exit(EXIT_FAILURE);
+	}
+	wins = w;
+	wins[nr_wins].win = win;
+	wins[nr_wins++].info = *info;
+}
+
+/**
+ * @brief Print each request that has been recorded, oldest first.
+ *
+ * Each line is of the form:
+ *
+ *	op window mask values...
+ *
+ * @param f Where the requests should be printed.
+ */
+void mock_print(FILE *f)
+{
+	unsigned long i;
+	unsigned int j;
+
+	for (i = 0; i < nr_reqs; i++) {
+		fprintf(f, "%s 0x%x 0x%x", reqs[i].op, reqs[i].win, reqs[i].mask);
+		for (j = 0; j < reqs[i].nr_vals; j++)
+			fprintf(f, " %u", reqs[i].vals[j]);
+		fputc('\n', f);
+	}
+}
+
+/**
+ * @brief The amount of requests recorded since the last reset.
+ *
+ * @return The amount of requests.
+ */
+unsigned long mock_request_cnt(void)
+{
+	return nr_reqs;
+}
+
+/**
+ * @brief Count the stored requests of one kind.
+ *
+ * @param op The name of the operation.
+ * @param mask Only requests whose value mask has all of these bits are
+ * counted.
+ *
+ * @return The amount of matching requests since the last reset.
+ */
+unsigned long mock_count(const char *op, uint32_t mask)
+{
+	unsigned long i, n = 0;
+
+	for (i = 0; i < nr_reqs && !discard; i++)
+		if (strcmp(reqs[i].op, op) == 0
+				&& (reqs[i].mask & mask) == mask)
+			n++;
+	return n;
+}
+
+/**
+ * @brief Choose whether requests are stored or only counted. Storing
+ * requests uses memory for each one, which adds up when benchmarking.
+ *
+ * @param only_count True if requests should only be counted.
+ */
+void mock_set_discard(bool only_count)
+{
+	mock_reset();
+	discard = only_count;
+}
+
+/**
+ * @brief Forget all of the recorded requests.
+ */
+void mock_reset(void)
+{
+	nr_reqs = 0;
+}
@@ -0,0 +1,504 @@
+#define LOG_SUBSYS LOG_CORE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+#include <xcb/xcb_ewmh.h>
+#include <xcb/xcb_icccm.h>
+#include <xcb/xcb_keysyms.h>
+
+#include "backend.h"
+#include "helper.h"
+#include "howm.h"
+#include "stats.h"
+#include "xcb_help.h"
+
+/**
+ * @file backend_xcb.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief The backend that sends requests to a real X server.
+ */
+
+const struct xbackend *xb = &xcb_backend;
+
+/** The keyboard mapping, fetched when it is first needed. */
+static xcb_key_symbols_t *keysyms;
+/** The sequence number of the marker that was sent after the last requests
+ * that could move a window under the pointer. */
+static uint32_t layout_seq;
+/** Such a request has been sent since the last marker. */
+static bool layout_dirty;
+/** The graphics context that labels are drawn with, created when the first
+ * label is drawn. */
+static xcb_gcontext_t label_gc;
+/** The metrics of TAB_FONT. */
+static int16_t font_ascent, font_descent, font_width;
+
+static void real_map(xcb_window_t win)
+{
+	XREQ(xcb_map_window(dpy, win));
+	layout_dirty = true;
+}
+
+static void real_unmap(xcb_window_t win)
+{
+	XREQ(xcb_unmap_window(dpy, win));
+	layout_dirty = true;
+}
+
+static void real_configure(xcb_window_t win, uint16_t mask, const uint32_t *vals)
+{
+	XREQ(xcb_configure_window(dpy, win, mask, vals));
+	layout_dirty = true;
+}
+
+static void real_change_attributes(xcb_window_t win, uint32_t mask,
+		const uint32_t *vals)
+{
+	XREQ(xcb_change_window_attributes(dpy, win, mask, vals));
+}
+
+static void real_set_property(xcb_window_t win, xcb_atom_t prop,
+		xcb_atom_t type, uint32_t len, const uint32_t *data)
+{
+	XREQ(xcb_change_property(dpy, XCB_PROP_MODE_REPLACE, win, prop, type,
+				 32, len, data));
+}
+
+static void real_focus(xcb_window_t win)
+{
+	XREQ(xcb_set_input_focus(dpy, XCB_INPUT_FOCUS_POINTER_ROOT, win,
+				 XCB_CURRENT_TIME));
+}
+
+static void real_grab(xcb_window_t win, uint8_t pointer_mode)
+{
+	XREQ(xcb_grab_button(dpy, 1, win, XCB_EVENT_MASK_BUTTON_PRESS,
+			pointer_mode, XCB_GRAB_MODE_ASYNC,
+			XCB_WINDOW_NONE, XCB_CURSOR_NONE,
+			XCB_BUTTON_INDEX_ANY, XCB_BUTTON_MASK_ANY));
+}
+
+static void real_grab_mouse(xcb_window_t win, uint16_t mods, uint8_t button)
+{
+	XREQ(xcb_grab_button(dpy, 0, win, XCB_EVENT_MASK_BUTTON_PRESS
+			| XCB_EVENT_MASK_BUTTON_RELEASE
+			| XCB_EVENT_MASK_POINTER_MOTION,
+			XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC,
+			XCB_WINDOW_NONE, XCB_CURSOR_NONE, button, mods));
+}
+
+static void real_ungrab(xcb_window_t win)
+{
+	XREQ(xcb_ungrab_button(dpy, XCB_BUTTON_INDEX_ANY, win, XCB_GRAB_ANY));
+}
+
+static void real_allow(xcb_timestamp_t time)
+{
+	XREQ(xcb_allow_events(dpy, XCB_ALLOW_REPLAY_POINTER, time));
+}
+
+static void real_kill(xcb_window_t win)
+{
+	XREQ(xcb_kill_client(dpy, win));
+}
+
+static void real_send(xcb_window_t win, const xcb_client_message_event_t *ev)
+{
+	XREQ(xcb_send_event(dpy, 0, win, XCB_EVENT_MASK_NO_EVENT,
+			    (const char *)ev));
+}
+
+static void real_warp(int16_t x, int16_t y)
+{
+	XREQ(xcb_warp_pointer(dpy, XCB_NONE, screen->root, 0, 0, 0, 0, x, y));
+	layout_dirty = true;
+}
+
+static void real_active_window(xcb_window_t win)
+{
+	XREQ(xcb_ewmh_set_active_window(ewmh, 0, win));
+}
+
+static void real_current_desktop(uint32_t desktop)
+{
+	XREQ(xcb_ewmh_set_current_desktop(ewmh, 0, desktop));
+}
+
+static void real_number_of_desktops(uint32_t cnt)
+{
+	XREQ(xcb_ewmh_set_number_of_desktops(ewmh, 0, cnt));
+}
+
+static void real_workarea(uint32_t len, xcb_ewmh_geometry_t *workarea)
+{
+	XREQ(xcb_ewmh_set_workarea(ewmh, 0, len, workarea));
+}
+
+static void real_frame_extents(xcb_window_t win, uint32_t space)
+{
+	XREQ(xcb_ewmh_set_frame_extents(ewmh, win, space, space, space, space));
+}
+
+/**
+ * @brief Fetch a window's attributes, type, transient hint and geometry.
+ *
+ * All four requests are sent before waiting on any of the replies.
+ *
+ * @param win The window to be queried.
+ * @param info Where to store what was found.
+ *
+ * @return False if the window's attributes couldn't be fetched, such as when
+ * it has already been destroyed.
+ */
+static bool real_window_info(xcb_window_t win, struct xwin_info *info)
+{
+	xcb_get_window_attributes_cookie_t wa_cookie;
+	xcb_get_property_cookie_t type_cookie, trans_cookie, pid_cookie;
+	xcb_get_geometry_cookie_t geom_cookie;
+	xcb_get_window_attributes_reply_t *wa;
+	xcb_ewmh_get_atoms_reply_t type;
+	xcb_get_geometry_reply_t *geom;
+	unsigned int i;
+
+	memset(info, 0, sizeof(*info));
+	wa_cookie = XREQ(xcb_get_window_attributes(dpy, win));
+	type_cookie = XREQ(xcb_ewmh_get_wm_window_type(ewmh, win));
+	trans_cookie = XREQ(xcb_icccm_get_wm_transient_for_unchecked(dpy, win));
+	geom_cookie = XREQ(xcb_get_geometry_unchecked(dpy, win));
+	pid_cookie = XREQ(xcb_ewmh_get_wm_pid_unchecked(ewmh, win));
+
+	stats_wait_begin();
+	wa = xcb_get_window_attributes_reply(dpy, wa_cookie, NULL);
+	stats_wait_end();
+	if (!wa) {
+		xcb_discard_reply(dpy, type_cookie.sequence);
+		xcb_discard_reply(dpy, trans_cookie.sequence);
+		xcb_discard_reply(dpy, geom_cookie.sequence);
+		xcb_discard_reply(dpy, pid_cookie.sequence);
+		return false;
+	}
+	info->override_redirect = wa->override_redirect;
+	free(wa);
+
+	stats_wait_begin();
+	if (xcb_ewmh_get_wm_window_type_reply(ewmh, type_cookie, &type, NULL) == 1) {
+		for (i = 0; i < type.atoms_len; i++) {
+			xcb_atom_t a = type.atoms[i];
+
+			if (a == ewmh->_NET_WM_WINDOW_TYPE_DOCK
+				|| a == ewmh->_NET_WM_WINDOW_TYPE_TOOLBAR)
+				info->is_dock = true;
+			else if (a == ewmh->_NET_WM_WINDOW_TYPE_NOTIFICATION
+				|| a == ewmh->_NET_WM_WINDOW_TYPE_DROPDOWN_MENU
+				|| a == ewmh->_NET_WM_WINDOW_TYPE_SPLASH
+				|| a == ewmh->_NET_WM_WINDOW_TYPE_POPUP_MENU
+				|| a == ewmh->_NET_WM_WINDOW_TYPE_TOOLTIP
+				|| a == ewmh->_NET_WM_WINDOW_TYPE_DIALOG)
+				info->wants_float = true;
+		}
+		xcb_ewmh_get_atoms_reply_wipe(&type);
+	}
+	stats_wait_end();
+
+	stats_wait_begin();
+	xcb_icccm_get_wm_transient_for_reply(dpy, trans_cookie,
+					     &info->transient_for, NULL);
+	stats_wait_end();
+
+	stats_wait_begin();
+	geom = xcb_get_geometry_reply(dpy, geom_cookie, NULL);
+	stats_wait_end();
+	if (geom) {
+		info->has_geom = true;
+		info->geom = (xcb_rectangle_t) { geom->x, geom->y,
+						 geom->width, geom->height };
+		free(geom);
+	}
+
+	stats_wait_begin();
+	xcb_ewmh_get_wm_pid_reply(ewmh, pid_cookie, &info->pid, NULL);
+	stats_wait_end();
+	return true;
+}
+
+/**
+ * @brief Check whether a window supports WM_DELETE_WINDOW.
+ *
+ * @param win The window to be checked.
+ *
+ * @return True if it does.
+ */
+static bool real_supports_delete(xcb_window_t win)
+{
+	xcb_icccm_get_wm_protocols_reply_t rep;
+	xcb_get_property_cookie_t cookie;
+	bool found = false, got_protocols;
+	unsigned int i;
+
+	cookie = XREQ(xcb_icccm_get_wm_protocols(dpy, win,
+						 wm_atoms[WM_PROTOCOLS]));
+	stats_wait_begin();
+	got_protocols = xcb_icccm_get_wm_protocols_reply(dpy, cookie, &rep, NULL);
+	stats_wait_end();
+	if (!got_protocols)
+		return false;
+
+	for (i = 0; i < rep.atoms_len && !found; i++)
+		found = rep.atoms[i] == wm_atoms[WM_DELETE_WINDOW];
+	xcb_icccm_get_wm_protocols_reply_wipe(&rep);
+	return found;
+}
+
+static void real_grab_key(xcb_window_t win, uint16_t mods, xcb_keycode_t code)
+{
+	XREQ(xcb_grab_key(dpy, 1, win, mods, code, XCB_GRAB_MODE_ASYNC,
+			  XCB_GRAB_MODE_ASYNC));
+}
+
+static void real_ungrab_keys(xcb_window_t win)
+{
+	XREQ(xcb_ungrab_key(dpy, XCB_GRAB_ANY, win, XCB_MOD_MASK_ANY));
+}
+
+/**
+ * @brief Get the keyboard mapping, fetching it if it isn't cached.
+ *
+ * @return The keyboard mapping.
+ */
+static xcb_key_symbols_t *get_keysyms(void)
+{
+	if (!keysyms) {
+		stats_request();
+		keysyms = xcb_key_symbols_alloc(dpy);
+		if (!keysyms) {
+			log_err("Can't allocate memory for the keyboard mapping");
+			exit(EXIT_FAILURE);
+		}
+	}
+	return keysyms;
+}
+
+static xcb_keycode_t *real_keysym_to_keycodes(xcb_keysym_t sym)
+{
+	xcb_keycode_t *codes;
+
+	stats_wait_begin();
+	codes = xcb_key_symbols_get_keycode(get_keysyms(), sym);
+	stats_wait_end();
+	return codes;
+}
+
+static xcb_keysym_t real_keycode_to_keysym(xcb_keycode_t code)
+{
+	return xcb_key_symbols_get_keysym(get_keysyms(), code, 0);
+}
+
+static void real_refresh_keymap(xcb_mapping_notify_event_t *ev)
+{
+	if (keysyms)
+		xcb_refresh_keyboard_mapping(keysyms, ev);
+}
+
+static xcb_window_t real_create_window(xcb_rectangle_t rect, uint32_t bg)
+{
+	xcb_window_t win = xcb_generate_id(dpy);
+	uint32_t vals[] = { bg, 1, XCB_EVENT_MASK_EXPOSURE
+		| XCB_EVENT_MASK_BUTTON_PRESS };
+
+	XREQ(xcb_create_window(dpy, XCB_COPY_FROM_PARENT, win, screen->root,
+			       rect.x, rect.y, rect.width, rect.height, 0,
+			       XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+			       XCB_CW_BACK_PIXEL | XCB_CW_OVERRIDE_REDIRECT
+			       | XCB_CW_EVENT_MASK, vals));
+	return win;
+}
+
+static void real_destroy_window(xcb_window_t win)
+{
+	XREQ(xcb_destroy_window(dpy, win));
+}
+
+/**
+ * @brief Open TAB_FONT and create the graphics context that labels are drawn
+ * with. This waits for the font's metrics, so is only done once.
+ */
+static void label_init(void)
+{
+	xcb_font_t font = xcb_generate_id(dpy);
+	xcb_query_font_cookie_t cookie;
+	xcb_query_font_reply_t *rep;
+
+	XREQ(xcb_open_font(dpy, font, strlen(TAB_FONT), TAB_FONT));
+	label_gc = xcb_generate_id(dpy);
+	XREQ(xcb_create_gc(dpy, label_gc, screen->root, XCB_GC_FONT, &font));
+	cookie = XREQ(xcb_query_font(dpy, font));
+	stats_wait_begin();
+	rep = xcb_query_font_reply(dpy, cookie, NULL);
+	stats_wait_end();
+	if (rep) {
+		font_ascent = rep->font_ascent;
+		font_descent = rep->font_descent;
+		font_width = rep->max_bounds.character_width;
+		free(rep);
+	} else {
+		log_warn("Can't query font %s", TAB_FONT);
+	}
+	XREQ(xcb_close_font(dpy, font));
+}
+
+static void real_draw_label(xcb_window_t win, uint32_t fg, uint32_t bg,
+			    xcb_rectangle_t rect, const char *text)
+{
+	uint32_t colours[] = { fg, bg };
+	size_t len = strlen(text), max;
+	int16_t pad = font_width / 2;
+
+	if (!label_gc)
+		label_init();
+	XREQ(xcb_change_gc(dpy, label_gc, XCB_GC_FOREGROUND, &bg));
+	XREQ(xcb_poly_fill_rectangle(dpy, win, label_gc, 1, &rect));
+
+	max = font_width > 0 && rect.width > 2 * pad
+		? (size_t)(rect.width - 2 * pad) / font_width : 0;
+	if (len > max)
+		len = max;
+	/* ImageText8 draws at most 255 characters. */
+	if (len > 255)
+		len = 255;
+	if (!len)
+		return;
+	XREQ(xcb_change_gc(dpy, label_gc, XCB_GC_FOREGROUND
+			   | XCB_GC_BACKGROUND, colours));
+	XREQ(xcb_image_text_8(dpy, len, win, label_gc, rect.x + pad,
+			      rect.y + (rect.height + font_ascent - font_descent) / 2,
+			      text));
+}
+
+/**
+ * @brief Copy a title, replacing anything that the core font can't draw.
+ *
+ * @param rep The reply holding the title.
+ * @param buf Where the title is stored.
+ * @param len The size of buf.
+ *
+ * @return True if the title wasn't empty.
+ */
+static bool copy_title(xcb_get_property_reply_t *rep, char *buf, size_t len)
+{
+	const char *s = xcb_get_property_value(rep);
+	size_t i, n = xcb_get_property_value_length(rep);
+
+	if (n >= len)
+		n = len - 1;
+	for (i = 0; i < n; i++)
+		buf[i] = s[i] >= ' ' && s[i] <= '~' ? s[i] : '?';
+	buf[n] = '\0';
+	return n > 0;
+}
+
+/**
+ * @brief Get a window's title, preferring _NET_WM_NAME over WM_NAME.
+ *
+ * Both properties are requested before waiting on either reply.
+ *
+ * @param win The window.
+ * @param buf Where the title is stored.
+ * @param len The size of buf.
+ *
+ * @return True if the window has a title.
+ */
+static bool real_get_title(xcb_window_t win, char *buf, size_t len)
+{
+	xcb_get_property_cookie_t net_cookie, icccm_cookie;
+	xcb_get_property_reply_t *rep;
+	bool found = false;
+
+	buf[0] = '\0';
+	net_cookie = XREQ(xcb_get_property(dpy, 0, win, ewmh->_NET_WM_NAME,
+					   ewmh->UTF8_STRING, 0, len / 4 + 1));
+	icccm_cookie = XREQ(xcb_get_property(dpy, 0, win, XCB_ATOM_WM_NAME,
+					     XCB_GET_PROPERTY_TYPE_ANY, 0,
+					     len / 4 + 1));
+
+	stats_wait_begin();
+	rep = xcb_get_property_reply(dpy, net_cookie, NULL);
+	stats_wait_end();
+	if (rep) {
+		found = copy_title(rep, buf, len);
+		free(rep);
+	}
+	if (found) {
+		xcb_discard_reply(dpy, icccm_cookie.sequence);
+		return true;
+	}
+
+	stats_wait_begin();
+	rep = xcb_get_property_reply(dpy, icccm_cookie, NULL);
+	stats_wait_end();
+	if (rep) {
+		found = copy_title(rep, buf, len);
+		free(rep);
+	}
+	return found;
+}
+
+static void real_mark_layout(void)
+{
+	if (!layout_dirty)
+		return;
+	layout_seq = XREQ(xcb_no_operation(dpy)).sequence;
+	layout_dirty = false;
+}
+
+static uint32_t real_layout_seq(void)
+{
+	return layout_seq;
+}
+
+static void real_flush_requests(void)
+{
+	real_mark_layout();
+	xcb_flush(dpy);
+}
+
+const struct xbackend xcb_backend = {
+	.name = "xcb",
+	.map_window = real_map,
+	.unmap_window = real_unmap,
+	.configure_window = real_configure,
+	.change_window_attributes = real_change_attributes,
+	.change_property = real_set_property,
+	.set_input_focus = real_focus,
+	.grab_button = real_grab,
+	.ungrab_button = real_ungrab,
+	.grab_mouse = real_grab_mouse,
+	.allow_events = real_allow,
+	.kill_client = real_kill,
+	.send_event = real_send,
+	.warp_pointer = real_warp,
+	.set_active_window = real_active_window,
+	.set_current_desktop = real_current_desktop,
+	.set_number_of_desktops = real_number_of_desktops,
+	.set_workarea = real_workarea,
+	.set_frame_extents = real_frame_extents,
+	.get_window_info = real_window_info,
+	.supports_delete = real_supports_delete,
+	.grab_key = real_grab_key,
+	.ungrab_keys = real_ungrab_keys,
+	.keysym_to_keycodes = real_keysym_to_keycodes,
+	.keycode_to_keysym = real_keycode_to_keysym,
+	.refresh_keymap = real_refresh_keymap,
+	.create_window = real_create_window,
+	.destroy_window = real_destroy_window,
+	.draw_label = real_draw_label,
+	.get_title = real_get_title,
+	.mark_layout = real_mark_layout,
+	.layout_seq = real_layout_seq,
+	.flush = real_flush_requests,
+};
@@ -1,15 +1,19 @@
+#define LOG_SUBSYS LOG_CLIENT
+
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_ewmh.h>
-#include <xcb/xcb_icccm.h>
 
+#include "backend.h"
 #include "client.h"
+#include "configure.h"
 #include "helper.h"
 #include "howm.h"
 #include "layout.h"
 #include "scratchpad.h"
+#include "trace.h"
 #include "workspace.h"
 #include "xcb_help.h"
 
@@ -25,6 +29,9 @@
  */
 
 static void move_down(client_t *c);
+static bool zoom_hidden(const client_t *c);
+static bool tab_hidden(const client_t *c);
+static bool tab_covered(const client_t *c);
 
 /**
  * @brief Find the client before the given client.
@@ -68,6 +75,33 @@ client_t *next_client(client_t *c)
 	return mon->ws->head;
 }
 
+/**
+ * @brief Find the client that is a number of places away from another,
+ * wrapping around either end of the client list.
+ *
+ * @param w The workspace that the client is on.
+ * @param c The client to start from.
+ * @param offset How many places to move, negative values move towards the
+ * head of the list.
+ *
+ * @return The client at the offset, or NULL if c isn't on w.
+ */
+client_t *offset_client(workspace_t *w, client_t *c, int offset)
+{
+	client_t *t;
+	int i = -1, n = 0;
+
+	for (t = w->head; t; t = t->next, n++)
+		if (t == c)
+			i = n;
+	if (i == -1)
+		return NULL;
+	i = ((i + offset % n) % n + n) % n;
+	for (t = w->head; i > 0; t = t->next, i--)
+		;
+	return t;
+}
+
 /**
  * @brief Sets c to the active window and gives it input focus. Sorts out
  * border colours as well.
@@ -84,9 +118,15 @@ void update_focused_client(client_t *c)
 	if (!c)
 		return;
 
+	/* Focusing any of the workspace's clients takes focus back from a
+	 * sticky client. */
+	if (mon->sticky_c) {
+		queue_border_colour(mon->sticky_c->win, conf.border_unfocus);
+		mon->sticky_c = NULL;
+	}
 	if (!mon->ws->head) {
 		mon->ws->prev_foc = mon->ws->c = NULL;
-		xcb_ewmh_set_active_window(ewmh, 0, XCB_NONE);
+		xb->set_active_window(XCB_NONE);
 		return;
 	} else if (c == mon->ws->prev_foc) {
 		mon->ws->prev_foc = prev_client(mon->ws->c = mon->ws->prev_foc, mon->ws);
@@ -95,7 +135,16 @@ void update_focused_client(client_t *c)
 		mon->ws->c = c;
 	}
 
-	log_info("Focusing client <%p>", c);
+	TRACE(TR_FOCUS, (uintptr_t)c, c->win);
+	/* The other clients are hidden, so leave their borders and stacking
+	 * alone until the fullscreen client loses focus. */
+	if (fullscreen_client(mon->ws)) {
+		elevate_window(mon->ws->c->win);
+		arrange_windows(mon);
+		xb->set_active_window(mon->ws->c->win);
+		xb->set_input_focus(mon->ws->c->win);
+		return;
+	}
 	for (c = mon->ws->head; c; c = c->next, ++all) {
 		if (FFT(c)) {
 			fullscreen++;
@@ -109,24 +158,33 @@ void update_focused_client(client_t *c)
 	windows[(mon->ws->c->is_floating || mon->ws->c->is_transient) ? 0 : float_trans] = mon->ws->c->win;
 	c = mon->ws->head;
 	for (fullscreen += !FFT(mon->ws->c) ? 1 : 0; c; c = c->next) {
-		set_border_width(c->win, c->is_fullscreen ? 0 : conf.border_px);
-		xcb_change_window_attributes(dpy, c->win, XCB_CW_BORDER_PIXEL,
-					     (c == mon->ws->c ? &conf.border_focus :
-					      c == mon->ws->prev_foc ? &conf.border_prev_focus
-					      : &conf.border_unfocus));
+		if (!zoom_hidden(c) && !tab_covered(c)) {
+			set_border_width(c->win, c->is_fullscreen ? 0 : conf.border_px);
+			queue_border_colour(c->win, c == mon->ws->c ? conf.border_focus
+					: c == mon->ws->prev_foc ? conf.border_prev_focus
+					: conf.border_unfocus);
+		}
 		if (c != mon->ws->c)
 			windows[c->is_fullscreen ? --fullscreen : FFT(c) ?
 				--float_trans : --all] = c->win;
 	}
 
+	/* Only the focused client and the floating, transient and fullscreen
+	 * clients are left below all, so tiled clients are never restacked.
+	 * They don't overlap, and the ones that the zoom layout hides stay
+	 * beneath the focused client. */
 	for (float_trans = 1; float_trans <= all; ++float_trans)
 		elevate_window(windows[all - float_trans]);
+	/* Sticky clients float above every workspace's clients. */
+	for (c = mon->sticky_head; c; c = c->next)
+		elevate_window(c->win);
 
-	xcb_ewmh_set_active_window(ewmh, 0, mon->ws->c->win);
-
-	xcb_set_input_focus(dpy, XCB_INPUT_FOCUS_POINTER_ROOT, mon->ws->c->win,
-			    XCB_CURRENT_TIME);
+	/* Arrange first, as the tabbed layout may need to map the client
+	 * before it can be given focus. */
 	arrange_windows(mon);
+	xb->set_active_window(mon->ws->c->win);
+
+	xb->set_input_focus(mon->ws->c->win);
 }
 
 /**
@@ -163,35 +221,77 @@ client_t *get_first_non_tff(monitor_t *m)
 }
 
 /**
- * @brief Remove a client from its workspace client list.
+ * @brief Unlink a client from its workspace client list without freeing it.
  *
- * @param m The monitor that the client to be removed is on.
- * @param w The workspace that the client to be removed is on.
- * @param c The client to be removed.
+ * Focus is passed on to another client on the workspace, if the workspace is
+ * currently visible.
+ *
+ * @param m The monitor that the client to be detached is on.
+ * @param w The workspace that the client to be detached is on.
+ * @param c The client to be detached.
+ *
+ * @return True if the client was found and detached, False otherwise.
  */
-void remove_client(monitor_t *m, workspace_t *w, client_t *c)
+bool detach_client(monitor_t *m, workspace_t *w, client_t *c)
 {
 	client_t **temp = NULL;
 
 	for (temp = &w->head; *temp; temp = &(*temp)->next)
 		if (*temp == c)
 			goto found;
-	return;
+	return false;
 
 found:
 	*temp = c->next;
+	c->next = NULL;
 
-	log_info("Removing client <%p>", c);
 	if (c == w->prev_foc)
 		w->prev_foc = prev_client(w->c, w);
-	if (c == w->c || !w->head->next) {
+	if (c == w->c || !w->head || !w->head->next) {
 		w->c = w->prev_foc ? w->prev_foc : w->head;
 		if (m->ws == w)
 			update_focused_client(w->c);
 	}
+	w->client_cnt--;
+	return true;
+}
+
+/**
+ * @brief Append a client to the end of a workspace's client list.
+ *
+ * @param w The workspace that the client should be added to.
+ * @param c The client to be added. It must not be in any other client list.
+ */
+void attach_client(workspace_t *w, client_t *c)
+{
+	client_t *t = prev_client(w->head, w); /* Get the last element. */
+
+	c->next = NULL;
+	if (!w->head)
+		w->head = c;
+	else if (t)
+		t->next = c;
+	else
+		w->head->next = c;
+	w->client_cnt++;
+}
+
+/**
+ * @brief Remove a client from its workspace client list.
+ *
+ * @param m The monitor that the client to be removed is on.
+ * @param w The workspace that the client to be removed is on.
+ * @param c The client to be removed.
+ */
+void remove_client(monitor_t *m, workspace_t *w, client_t *c)
+{
+	if (!detach_client(m, w, c))
+		return;
+
+	log_info("Removing client <%p>", c);
+	scratchpad_release(c);
 	free(c);
 	c = NULL;
-	w->client_cnt--;
 }
 
 /**
@@ -259,7 +359,6 @@ void focus_next_client(void)
 {
 	if (!mon->ws->c || !mon->ws->head->next)
 		return;
-	log_info("Focusing next client");
 	update_focused_client(mon->ws->c->next ? mon->ws->c->next : mon->ws->head);
 }
 
@@ -272,7 +371,6 @@ void focus_prev_client(void)
 {
 	if (!mon->ws->c || !mon->ws->head->next)
 		return;
-	log_info("Focusing previous client");
 	mon->ws->prev_foc = mon->ws->c;
 	update_focused_client(prev_client(mon->ws->prev_foc, mon->ws));
 }
@@ -286,62 +384,108 @@ void focus_prev_client(void)
  */
 void kill_client(monitor_t *m, workspace_t *w, client_t *c)
 {
-	xcb_icccm_get_wm_protocols_reply_t rep;
-	unsigned int i;
-	bool found = false;
+	kill_clients(m, w, c, 1);
+}
 
-	if (!c)
+/**
+ * @brief Kill a run of clients.
+ *
+ * The whole run is taken out of the client list before anything is
+ * refocused, so the workspace is only refocused (and rearranged) once,
+ * however many clients are killed.
+ *
+ * @param m The monitor that the clients are on.
+ * @param w The workspace that the clients are on.
+ * @param c The first client to be killed.
+ * @param cnt How many clients to kill, counting on from c and wrapping around
+ * the end of the client list.
+ */
+void kill_clients(monitor_t *m, workspace_t *w, client_t *c, unsigned int cnt)
+{
+	client_t **pp, *dead = NULL;
+	bool refocus = false, lost_prev = false;
+
+	for (pp = &w->head; *pp && *pp != c; pp = &(*pp)->next)
+		;
+	if (!c || !*pp)
 		return;
+	if (cnt > w->client_cnt)
+		cnt = w->client_cnt;
+
+	for (; cnt > 0 && w->head; cnt--) {
+		if (!*pp)
+			pp = &w->head;
+		c = *pp;
+		*pp = c->next;
+		c->next = dead;
+		dead = c;
+		refocus |= c == w->c;
+		lost_prev |= c == w->prev_foc;
+		w->client_cnt--;
+	}
+
+	if (lost_prev)
+		w->prev_foc = NULL;
+	if (refocus)
+		w->c = w->prev_foc ? w->prev_foc : w->head;
+	if (lost_prev)
+		w->prev_foc = prev_client(w->c, w);
 
-	if (xcb_icccm_get_wm_protocols_reply(dpy,
-				xcb_icccm_get_wm_protocols(dpy,
-					c->win,
-					wm_atoms[WM_PROTOCOLS]), &rep, NULL)) {
-		for (i = 0; i < rep.atoms_len; ++i)
-			if (rep.atoms[i] == wm_atoms[WM_DELETE_WINDOW]) {
-				delete_win(c->win);
-				found = true;
-				break;
-			}
-		xcb_icccm_get_wm_protocols_reply_wipe(&rep);
+	while (dead) {
+		c = dead;
+		dead = c->next;
+		if (xb->supports_delete(c->win))
+			delete_win(c->win);
+		else
+			xb->kill_client(c->win);
+		log_info("Killing Client <%p>", c);
+		scratchpad_release(c);
+		free(c);
 	}
-	if (!found)
-		xcb_kill_client(dpy, c->win);
-	log_info("Killing Client <%p>", c);
-	remove_client(m, w, c);
+
+	if (m->ws != w)
+		return;
+	if (w->c)
+		update_focused_client(w->c);
+	else
+		focus_root();
 }
 
 /**
- * @brief Moves a client either upwards or down.
+ * @brief Moves the current client either upwards or down.
  *
- * Moves a single client or multiple clients either up or
- * down. The op_move_* functions serves as simple wrappers to this.
+ * The client is taken out of the client list and inserted once at its new
+ * position, so the workspace is only arranged once whatever the count. Like
+ * a single move, the client wraps around either end of the list. The op_move_*
+ * functions serve as simple wrappers to this.
  *
- * @param cnt How many clients to move.
- * @param up Whether to move the clients up or down. True is up.
+ * @param cnt How many places to move the client.
+ * @param up Whether to move the client up or down. True is up.
  */
 void move_client(int cnt, bool up)
 {
-	int cntcopy;
-	client_t *c;
+	client_t **pp, *c = mon->ws->c;
+	int i = 0, n = 0, target;
 
-	if (up) {
-		if (mon->ws->c == mon->ws->head)
-			return;
-		c = prev_client(mon->ws->c, mon->ws);
-		/* TODO optimise this by inserting the client only once
-			* and in the correct location.*/
-		for (; cnt > 0; move_down(c), cnt--)
-			;
-	} else {
-		if (mon->ws->c == prev_client(mon->ws->head, mon->ws))
-			return;
-		cntcopy = cnt;
-		for (c = mon->ws->c; cntcopy > 0; c = next_client(c), cntcopy--)
-			;
-		for (; cnt > 0; move_up(c), cnt--)
-			;
-	}
+	if (!c || cnt <= 0)
+		return;
+	for (pp = &mon->ws->head; *pp; pp = &(*pp)->next, n++)
+		if (*pp == c)
+			i = n;
+	target = ((up ? i - cnt % n : i + cnt % n) % n + n) % n;
+	if (target == i)
+		return;
+
+	for (pp = &mon->ws->head; *pp != c; pp = &(*pp)->next)
+		;
+	*pp = c->next;
+	for (pp = &mon->ws->head; target > 0; pp = &(*pp)->next, target--)
+		;
+	c->next = *pp;
+	*pp = c;
+	log_info("Moved client <%p> on workspace <%d> %d places %s", c,
+			workspace_to_index(mon->ws), cnt, up ? "up" : "down");
+	arrange_windows(mon);
 }
 
 /**
@@ -399,7 +543,7 @@ void client_to_ws(client_t *c, workspace_t *ws, bool follow)
 	mon->ws->client_cnt--;
 
 	c->next = NULL;
-	xcb_unmap_window(dpy, c->win);
+	xb->unmap_window(c->win);
 
 	log_info("Moved client <%p> from <%d> to <%d>", c,
 			workspace_to_index(mon->ws),
@@ -412,34 +556,129 @@ void client_to_ws(client_t *c, workspace_t *ws, bool follow)
 	}
 }
 
+/**
+ * @brief Find the client that hides every other client on a workspace.
+ *
+ * While the focused client is fullscreen it is stacked above the rest, which
+ * are frozen: they aren't configured, restacked or recoloured until the
+ * fullscreen client loses focus or leaves fullscreen.
+ *
+ * @param ws The workspace to check.
+ *
+ * @return The focused client if it is fullscreen, otherwise NULL.
+ */
+client_t *fullscreen_client(const workspace_t *ws)
+{
+	return ws->c && ws->c->is_fullscreen ? ws->c : NULL;
+}
+
+/**
+ * @brief Check whether a client is hidden behind the focused client by the
+ * zoom layout.
+ *
+ * @param c A client on the current workspace.
+ *
+ * @return True if c is tiled and covered by the focused, tiled client.
+ */
+static bool zoom_hidden(const client_t *c)
+{
+	const workspace_t *ws = mon->ws;
+
+	return ws->layout == ZOOM && ws->c && c != ws->c && !FFT(ws->c)
+		&& !FFT(c);
+}
+
+/**
+ * @brief Check whether a client is unmapped because it isn't the active tab
+ * of the tabbed layout.
+ *
+ * @param c A client on the current workspace.
+ *
+ * @return True if c is tiled, hidden and the workspace is still tabbed.
+ */
+static bool tab_hidden(const client_t *c)
+{
+	const workspace_t *ws = mon->ws;
+
+	return c->is_tab_hidden && ws->layout == TABBED && ws->head->next
+		&& !FFT(c);
+}
+
+/**
+ * @brief Check whether a client won't be shown by the tabbed layout, as
+ * another tab is focused.
+ *
+ * @param c A client on the current workspace.
+ *
+ * @return True if c is tiled and the focused client is the active tab.
+ */
+static bool tab_covered(const client_t *c)
+{
+	const workspace_t *ws = mon->ws;
+
+	return ws->layout == TABBED && ws->head->next && ws->c && c != ws->c
+		&& !FFT(ws->c) && !FFT(c);
+}
+
+/**
+ * @brief Configure a single client's window to match its geometry.
+ *
+ * @param c The client to be drawn.
+ */
+static void draw_client(client_t *c)
+{
+	c->is_stale = false;
+	if (mon->ws->layout == ZOOM && conf.zoom_gap && !c->is_floating
+			&& !c->is_fullscreen) {
+		set_border_width(c->win, 0);
+		move_resize(c->win, c->rect.x + c->gap, c->rect.y + c->gap,
+				c->rect.width - (2 * c->gap), c->rect.height - (2 * c->gap));
+	} else if (c->is_floating && !c->is_fullscreen) {
+		set_border_width(c->win, conf.border_px);
+		move_resize(c->win, c->rect.x, c->rect.y, c->rect.width, c->rect.height);
+	} else if (c->is_fullscreen || mon->ws->layout == ZOOM) {
+		set_border_width(c->win, 0);
+		move_resize(c->win, c->rect.x, c->rect.y, c->rect.width, c->rect.height);
+	} else {
+		move_resize(c->win, c->rect.x + c->gap, c->rect.y + c->gap,
+				c->rect.width - (2 * (c->gap + conf.border_px)),
+				c->rect.height - (2 * (c->gap + conf.border_px)));
+	}
+}
+
 /**
  * @brief Arrange the client's windows on the screen.
  *
  * This function takes some strain off of the layout handlers by passing the
  * client's dimensions to move_resize. This splits the layout handlers into
  * smaller, more understandable parts.
+ *
+ * Only the fullscreen client is drawn while it hides the others. The
+ * monitor's sticky clients are drawn along with the workspace's floating
+ * clients.
  */
 void draw_clients(void)
 {
-	client_t *c = NULL;
+	client_t *c = fullscreen_client(mon->ws);
 
-	log_debug("Drawing clients");
+	TRACE(TR_DRAW, workspace_to_index(mon->ws), c ? 1 : mon->ws->client_cnt);
+	if (c) {
+		draw_client(c);
+		return;
+	}
+	/* A client hidden by the zoom or tabbed layouts is drawn once it is
+	 * focused. When zoom_gap leaves its edges showing, it is also drawn
+	 * whenever its geometry changes, so that it stays exactly behind the
+	 * focused client. */
 	for (c = mon->ws->head; c; c = c->next)
-		if (mon->ws->layout == ZOOM && conf.zoom_gap && !c->is_floating) {
-			set_border_width(c->win, 0);
-			move_resize(c->win, c->rect.x + c->gap, c->rect.y + c->gap,
-					c->rect.width - (2 * c->gap), c->rect.height - (2 * c->gap));
-		} else if (c->is_floating && !c->is_fullscreen) {
-			set_border_width(c->win, conf.border_px);
-			move_resize(c->win, c->rect.x, c->rect.y, c->rect.width, c->rect.height);
-		} else if (c->is_fullscreen || mon->ws->layout == ZOOM) {
-			set_border_width(c->win, 0);
-			move_resize(c->win, c->rect.x, c->rect.y, c->rect.width, c->rect.height);
-		} else {
-			move_resize(c->win, c->rect.x + c->gap, c->rect.y + c->gap,
-					c->rect.width - (2 * (c->gap + conf.border_px)),
-					c->rect.height - (2 * (c->gap + conf.border_px)));
-		}
+		if (!tab_hidden(c) && (!zoom_hidden(c)
+					|| (conf.zoom_gap && c->is_stale)))
+			draw_client(c);
+	/* Sticky clients keep their geometry from workspace to workspace, so
+	 * they only need to be drawn when it changes. */
+	for (c = mon->sticky_head; c; c = c->next)
+		if (c->is_stale)
+			draw_client(c);
 }
 
 /**
@@ -453,8 +692,10 @@ void draw_clients(void)
  */
 void change_client_geom(client_t *c, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
 {
-	log_debug("Changing geometry of client <%p> from {%d, %d, %d, %d} to {%d, %d, %d, %d}",
-			c, c->rect.x, c->rect.y, c->rect.width, c->rect.height, x, y, w, h);
+	TRACE(TR_GEOM, (uintptr_t)c, w, h, x, y);
+	if (c->rect.x != x || c->rect.y != y || c->rect.width != w
+			|| c->rect.height != h)
+		c->is_stale = true;
 	c->rect = (xcb_rectangle_t) { x, y, w, h };
 }
 
@@ -472,10 +713,11 @@ void change_client_gaps(client_t *c, int size)
 		c->gap = 0;
 	else
 		c->gap += size;
+	c->is_stale = true;
 
 	uint32_t space = c->gap + conf.border_px;
 
-	xcb_ewmh_set_frame_extents(ewmh, c->win, space, space, space, space);
+	xb->set_frame_extents(c->win, space);
 	draw_clients();
 }
 
@@ -491,8 +733,7 @@ client_t *create_client(xcb_window_t w)
 {
 	client_t *c = (client_t *)calloc(1, sizeof(client_t));
 	client_t *t = prev_client(mon->ws->head, mon->ws); /* Get the last element. */
-	uint32_t vals[1] = { XCB_EVENT_MASK_PROPERTY_CHANGE
-				| XCB_EVENT_MASK_ENTER_WINDOW };
+	uint32_t vals[1] = { client_event_mask() };
 
 	if (!c) {
 		log_err("Can't allocate memory for client.");
@@ -506,10 +747,11 @@ client_t *create_client(xcb_window_t w)
 		mon->ws->head->next = c;
 	c->win = w;
 	c->gap = mon->ws->gap;
-	xcb_change_window_attributes(dpy, c->win, XCB_CW_EVENT_MASK, vals);
+	c->is_stale = true;
+	xb->change_window_attributes(c->win, XCB_CW_EVENT_MASK, vals);
 	uint32_t space = c->gap + conf.border_px;
 
-	xcb_ewmh_set_frame_extents(ewmh, c->win, space, space, space, space);
+	xb->set_frame_extents(c->win, space);
 	log_info("Created client <%p>", c);
 	mon->ws->client_cnt++;
 	return c;
@@ -524,24 +766,32 @@ client_t *create_client(xcb_window_t w)
  */
 void set_fullscreen(client_t *c, bool fscr)
 {
-	long data[] = {fscr ? ewmh->_NET_WM_STATE_FULLSCREEN : XCB_NONE };
+	uint32_t data[] = {fscr ? ewmh->_NET_WM_STATE_FULLSCREEN : XCB_NONE };
+	uint32_t bypass = fscr;
 
 	if (!c || fscr == c->is_fullscreen)
 		return;
 
 	c->is_fullscreen = fscr;
 	log_info("Setting client <%p>'s fullscreen state to %d", c, fscr);
-	xcb_change_property(dpy, XCB_PROP_MODE_REPLACE,
-			c->win, ewmh->_NET_WM_STATE, XCB_ATOM_ATOM, 32,
+	xb->change_property(c->win, ewmh->_NET_WM_STATE, XCB_ATOM_ATOM,
 			fscr, data);
+	/* Let a compositor unredirect the client while it covers the screen. */
+	xb->change_property(c->win, wm_atoms[NET_WM_BYPASS_COMPOSITOR],
+			XCB_ATOM_CARDINAL, 1, &bypass);
 	if (fscr) {
-		set_border_width(c->win, 0);
-		change_client_geom(c, 0, 0, mon->rect.width, mon->rect.height);
+		change_client_geom(c, mon->rect.x, mon->rect.y,
+				mon->rect.width, mon->rect.height);
+		if (c == mon->ws->c)
+			elevate_window(c->win);
 		draw_clients();
 	} else {
 		set_border_width(c->win, !mon->ws->head->next ? 0 : conf.border_px);
-		arrange_windows(mon);
-		draw_clients();
+		/* Catch up on the borders and stacking that were frozen. */
+		if (c == mon->ws->c)
+			update_focused_client(c);
+		else
+			arrange_windows(mon);
 	}
 }
 
@@ -551,9 +801,8 @@ void set_urgent(client_t *c, bool urg)
 		return;
 
 	c->is_urgent = urg;
-	xcb_change_window_attributes(dpy, c->win, XCB_CW_BORDER_PIXEL,
-			urg ? &conf.border_urgent : c == mon->ws->c
-			? &conf.border_focus : &conf.border_unfocus);
+	queue_border_colour(c->win, urg ? conf.border_urgent
+			: c == mon->ws->c ? conf.border_focus : conf.border_unfocus);
 }
 
 /**
@@ -790,54 +1039,38 @@ void resize_master(const int ds)
 }
 
 /**
- * @brief Remove a list of clients from howm's delete register stack and paste
+ * @brief Remove a run of clients from howm's delete register stack and paste
  * them after the currently focused window.
  *
+ * The run is spliced into the client list in one go, without walking it.
+ *
  * @ingroup commands
  */
 void paste(void)
 {
-	client_t *head = stack_pop(&del_reg);
-	client_t *t, *c = head;
+	struct client_run run = stack_pop(&del_reg);
+	client_t *c;
 
-	if (!head) {
+	if (!run.head) {
 		log_warn("No clients on stack.");
 		return;
 	}
 
+	for (c = run.head; c; c = c->next) {
+		c->is_tab_hidden = false;
+		xb->map_window(c->win);
+	}
+
 	if (!mon->ws->c) {
-		mon->ws->head = head;
-		mon->ws->c = head;
-		while (c) {
-			xcb_map_window(dpy, c->win);
-			mon->ws->c = c;
-			c = c->next;
-			mon->ws->client_cnt++;
-		}
-	} else if (!mon->ws->c->next) {
-		mon->ws->c->next = head;
-		while (c) {
-			xcb_map_window(dpy, c->win);
-			mon->ws->c = c;
-			c = c->next;
-			mon->ws->client_cnt++;
-		}
+		run.tail->next = mon->ws->head;
+		mon->ws->head = run.head;
 	} else {
-		t = mon->ws->c->next;
-		mon->ws->c->next = head;
-		while (c) {
-			xcb_map_window(dpy, c->win);
-			mon->ws->client_cnt++;
-			if (!c->next) {
-				c->next = t;
-				mon->ws->c = c;
-				break;
-			} else {
-				mon->ws->c = c;
-				c = c->next;
-			}
-		}
+		run.tail->next = mon->ws->c->next;
+		mon->ws->c->next = run.head;
 	}
+	mon->ws->client_cnt += run.cnt;
+	log_info("Pasted %u clients after <%p>", run.cnt, mon->ws->c);
+	mon->ws->c = run.tail;
 	update_focused_client(mon->ws->c);
 }
 
@@ -859,7 +1092,7 @@ void toggle_bar(void)
 	}
 	xcb_ewmh_geometry_t workarea[] = { { 0, conf.bar_bottom ? 0 : mon->ws->bar_height,
 				mon->rect.width, mon->rect.height - mon->ws->bar_height } };
-	xcb_ewmh_set_workarea(ewmh, 0, LENGTH(workarea), workarea);
+	xb->set_workarea(LENGTH(workarea), workarea);
 	arrange_windows(mon);
 }
 
@@ -24,14 +24,19 @@ int get_non_tff_count(monitor_t *m);
 client_t *get_first_non_tff(monitor_t *m);
 void change_client_gaps(client_t *c, int size);
 void kill_client(monitor_t *m, workspace_t *w, client_t *c);
+void kill_clients(monitor_t *m, workspace_t *w, client_t *c, unsigned int cnt);
 void move_up(client_t *c);
 client_t *next_client(client_t *c);
 void update_focused_client(client_t *c);
 client_t *prev_client(client_t *c, workspace_t *w);
+client_t *offset_client(workspace_t *w, client_t *c, int offset);
 client_t *create_client(xcb_window_t w);
 void remove_client(monitor_t *m, workspace_t *w, client_t *c);
+bool detach_client(monitor_t *m, workspace_t *w, client_t *c);
+void attach_client(workspace_t *w, client_t *c);
 void client_to_ws(client_t *c, workspace_t *ws, bool follow);
 void draw_clients(void);
+client_t *fullscreen_client(const workspace_t *ws);
 void change_client_geom(client_t *c, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
 void set_fullscreen(client_t *c, bool fscr);
 void set_urgent(client_t *c, bool urg);
@@ -0,0 +1,210 @@
+#define LOG_SUBSYS LOG_CORE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#include "backend.h"
+#include "configure.h"
+#include "helper.h"
+#include "howm.h"
+
+/**
+ * @file configure.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Changes to windows are queued here and sent together, so that each
+ * window receives at most one ConfigureWindow and one ChangeWindowAttributes
+ * per commit.
+ *
+ * A single command or event often sets a window's border width, geometry and
+ * stacking separately (update_focused_client() followed by
+ * arrange_windows(), for example). Each of those would be a separate request,
+ * and a separate repaint for the client. Instead, the values are merged
+ * per window and sent by configure_commit(), which the main loop calls
+ * before flushing the connection.
+ *
+ * Windows are committed in the order that they were first queued, except
+ * that queueing a stack mode moves a window to the back of the queue. That
+ * keeps the final stacking order the same as if each request had been sent
+ * straight away.
+ */
+
+/**
+ * @brief The changes to a window that haven't been sent yet.
+ */
+struct pending_cfg {
+	xcb_window_t win;
+	uint16_t mask; /**< The XCB_CONFIG_WINDOW_* values that are set. */
+	bool has_border; /**< border_pixel should be sent. */
+	uint32_t border_pixel; /**< The colour of the window's border. */
+	uint32_t vals[CONFIGURE_NR_VALS]; /**< Indexed by their bit in mask. */
+};
+
+static struct pending_cfg *pending;
+static unsigned int nr_pending, cap_pending;
+/** An open addressed hash table of windows, each slot holds 1 + the index of
+ * the window's entry in pending, or 0 if it is empty. */
+static unsigned int *slots;
+static unsigned int slot_bits;
+
+/**
+ * @brief Find the slot for a window in the hash table.
+ *
+ * @param win The window.
+ *
+ * @return The slot that holds the window, or the empty slot where it should
+ * be stored.
+ */
+static unsigned int *find_slot(xcb_window_t win)
+{
+	unsigned int mask = (1U << slot_bits) - 1;
+	unsigned int i = (uint32_t)(win * 2654435761U) >> (32 - slot_bits);
+
+	while (slots[i] && pending[slots[i] - 1].win != win)
+		i = (i + 1) & mask;
+	return &slots[i];
+}
+
+/**
+ * @brief Double the size of the hash table, keeping it no more than half
+ * full.
+ */
+static void grow_slots(void)
+{
+	unsigned int i;
+
+	slot_bits = slot_bits ? slot_bits + 1 : 6;
+	free(slots);
+	slots = calloc(1U << slot_bits, sizeof(*slots));
+	if (!slots) {
+		log_err("Can't allocate memory for pending configures");
+		exit(EXIT_FAILURE);
+	}
+	/* A window that was moved to the back of the queue has an earlier,
+	 * empty entry as well. The later entry replaces it here. */
+	for (i = 0; i < nr_pending; i++)
+		*find_slot(pending[i].win) = i + 1;
+}
+
+/**
+ * @brief Find the pending changes to a window, adding an entry if there are
+ * none.
+ *
+ * @param win The window.
+ * @param restack Move the window to the back of the queue.
+ *
+ * @return The window's entry.
+ */
+static struct pending_cfg *get_pending(xcb_window_t win, bool restack)
+{
+	struct pending_cfg *p;
+	unsigned int *slot;
+
+	if (nr_pending + 1 > (1U << slot_bits) / 2)
+		grow_slots();
+	slot = find_slot(win);
+	if (*slot && !restack)
+		return &pending[*slot - 1];
+
+	if (nr_pending == cap_pending) {
+		cap_pending = cap_pending ? cap_pending * 2 : 32;
+		pending = realloc(pending, cap_pending * sizeof(*pending));
+		if (!pending) {
+			log_err("Can't allocate memory for pending configures");
+			exit(EXIT_FAILURE);
+		}
+	}
+	p = &pending[nr_pending];
+	if (*slot) {
+		/* Leave the old entry empty, so nothing is sent for it. */
+		*p = pending[*slot - 1];
+		pending[*slot - 1].mask = 0;
+		pending[*slot - 1].has_border = false;
+	} else {
+		memset(p, 0, sizeof(*p));
+		p->win = win;
+	}
+	*slot = ++nr_pending;
+	return p;
+}
+
+/**
+ * @brief Queue a ConfigureWindow request, merging it with any others for the
+ * same window.
+ *
+ * @param win The window to be configured.
+ * @param mask The XCB_CONFIG_WINDOW_* values that are given.
+ * @param vals The values, in the same order as a ConfigureWindow request.
+ */
+void queue_configure(xcb_window_t win, uint16_t mask, const uint32_t *vals)
+{
+	struct pending_cfg *p;
+	unsigned int i;
+
+	p = get_pending(win, mask & XCB_CONFIG_WINDOW_STACK_MODE);
+	/* A sibling only makes sense with the stack mode it was sent with. */
+	if (mask & XCB_CONFIG_WINDOW_STACK_MODE)
+		p->mask &= ~XCB_CONFIG_WINDOW_SIBLING;
+	for (i = 0; i < CONFIGURE_NR_VALS; i++)
+		if (mask & (1U << i))
+			p->vals[i] = *vals++;
+	p->mask |= mask;
+}
+
+/**
+ * @brief Queue a change to the colour of a window's border.
+ *
+ * @param win The window.
+ * @param pixel The new colour of its border.
+ */
+void queue_border_colour(xcb_window_t win, uint32_t pixel)
+{
+	struct pending_cfg *p = get_pending(win, false);
+
+	p->has_border = true;
+	p->border_pixel = pixel;
+}
+
+/**
+ * @brief Send every change that has been queued.
+ */
+void configure_commit(void)
+{
+	uint32_t vals[CONFIGURE_NR_VALS];
+	struct pending_cfg *p;
+	unsigned int i, j, n;
+
+	if (!nr_pending)
+		return;
+	for (i = 0; i < nr_pending; i++) {
+		p = &pending[i];
+		if (p->mask) {
+			for (j = 0, n = 0; j < CONFIGURE_NR_VALS; j++)
+				if (p->mask & (1U << j))
+					vals[n++] = p->vals[j];
+			xb->configure_window(p->win, p->mask, vals);
+		}
+		if (p->has_border)
+			xb->change_window_attributes(p->win,
+					XCB_CW_BORDER_PIXEL, &p->border_pixel);
+	}
+	nr_pending = 0;
+	memset(slots, 0, (1U << slot_bits) * sizeof(*slots));
+}
+
+/**
+ * @brief Free the queue, without sending anything that is still queued.
+ */
+void configure_cleanup(void)
+{
+	free(pending);
+	free(slots);
+	pending = NULL;
+	slots = NULL;
+	nr_pending = cap_pending = slot_bits = 0;
+}
@@ -0,0 +1,26 @@
+#ifndef CONFIGURE_H
+#define CONFIGURE_H
+
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+/**
+ * @file configure.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The amount of values a ConfigureWindow request can carry, one for each
+ * XCB_CONFIG_WINDOW_* bit. */
+#define CONFIGURE_NR_VALS 7
+
+void queue_configure(xcb_window_t win, uint16_t mask, const uint32_t *vals);
+void queue_border_colour(xcb_window_t win, uint32_t pixel);
+void configure_commit(void);
+void configure_cleanup(void);
+
+#endif
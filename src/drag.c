@@ -0,0 +1,220 @@
+#define LOG_SUBSYS LOG_HANDLER
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <xcb/xcb.h>
+
+#include "backend.h"
+#include "client.h"
+#include "drag.h"
+#include "helper.h"
+#include "howm.h"
+#include "location.h"
+#include "stats.h"
+#include "sticky.h"
+#include "trace.h"
+#include "xcb_help.h"
+
+/**
+ * @file drag.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Moving and resizing floating clients by dragging them with the
+ * mouse while holding conf.drag_mods.
+ *
+ * The buttons are grabbed on the root window, so that the drag starts
+ * whichever client is under the pointer. While the button is held, motion
+ * events only record where the pointer is. The client is configured once the
+ * queue of events has been drained, by drag_flush(), and no more than
+ * conf.drag_rate times a second. A large window therefore gets a single
+ * configure per batch of motion, rather than one for each event.
+ */
+
+/**
+ * @brief The drag that is in progress.
+ */
+static struct {
+	xcb_window_t win; /**< The client's window, or XCB_NONE if not dragging. */
+	bool resize; /**< Resize the client, rather than moving it. */
+	int16_t start_x, start_y; /**< Where the pointer was pressed. */
+	xcb_rectangle_t start; /**< The client's geometry when pressed. */
+	int16_t x, y; /**< Where the pointer was last seen. */
+	bool pending; /**< The pointer has moved since the last configure. */
+	uint64_t last_us; /**< When the client was last configured. */
+} drag;
+
+/**
+ * @brief Grab the drag buttons on the root window, with conf.drag_mods held.
+ * This should be called again when conf.drag_mods changes.
+ */
+void drag_grab(void)
+{
+	static const uint16_t ignored[] = { 0, XCB_MOD_MASK_LOCK,
+		XCB_MOD_MASK_2, XCB_MOD_MASK_LOCK | XCB_MOD_MASK_2 };
+	unsigned int i;
+
+	xb->ungrab_button(screen->root);
+	if (!conf.drag_mods)
+		return;
+	for (i = 0; i < LENGTH(ignored); i++) {
+		xb->grab_mouse(screen->root, conf.drag_mods | ignored[i],
+				DRAG_MOVE_BUTTON);
+		xb->grab_mouse(screen->root, conf.drag_mods | ignored[i],
+				DRAG_RESIZE_BUTTON);
+	}
+}
+
+/**
+ * @brief Find the client that owns a window, whether it is on a workspace or
+ * sticky.
+ *
+ * @param win The window.
+ * @param shown Only look at the clients that are shown on the current
+ * monitor.
+ *
+ * @return The client, or NULL if there isn't one.
+ */
+static client_t *drag_find(xcb_window_t win, bool shown)
+{
+	location_t loc;
+	monitor_t *m;
+	client_t *c;
+
+	if (loc_win(&loc, win))
+		return !shown || (loc.mon == mon && loc.ws == mon->ws)
+			? loc.c : NULL;
+	c = sticky_find(win, &m);
+	return c && (!shown || m == mon) ? c : NULL;
+}
+
+/**
+ * @brief Start dragging the floating client under the pointer.
+ *
+ * @param be The button press, which must be reported on the root window.
+ *
+ * @return True if the press started a drag.
+ */
+bool drag_start(xcb_button_press_event_t *be)
+{
+	client_t *c;
+
+	if (be->event != screen->root || !conf.drag_mods
+			|| (be->detail != DRAG_MOVE_BUTTON
+			&& be->detail != DRAG_RESIZE_BUTTON))
+		return false;
+	c = drag_find(be->child, true);
+	if (!c || !c->is_floating || c->is_fullscreen)
+		return false;
+
+	TRACE(TR_DRAG, c->win, be->detail == DRAG_RESIZE_BUTTON);
+	if (c->is_sticky)
+		sticky_focus(mon, c);
+	else if (c != mon->ws->c)
+		update_focused_client(c);
+	drag.win = c->win;
+	drag.resize = be->detail == DRAG_RESIZE_BUTTON;
+	drag.start_x = drag.x = be->root_x;
+	drag.start_y = drag.y = be->root_y;
+	drag.start = c->rect;
+	drag.pending = false;
+	drag.last_us = 0;
+	return true;
+}
+
+/**
+ * @brief Configure the dragged client to follow the pointer.
+ */
+static void drag_apply(void)
+{
+	client_t *c;
+	int dx = drag.x - drag.start_x, dy = drag.y - drag.start_y;
+
+	drag.pending = false;
+	/* The client may have gone away in the middle of the drag. */
+	c = drag_find(drag.win, false);
+	if (!c) {
+		drag.win = XCB_NONE;
+		return;
+	}
+	if (drag.resize) {
+		c->rect.width = (int)drag.start.width + dx > 1
+			? drag.start.width + dx : 1;
+		c->rect.height = (int)drag.start.height + dy > 1
+			? drag.start.height + dy : 1;
+	} else {
+		c->rect.x = drag.start.x + dx;
+		c->rect.y = drag.start.y + dy;
+	}
+	move_resize(c->win, c->rect.x, c->rect.y, c->rect.width, c->rect.height);
+	drag.last_us = stats_now_us();
+}
+
+/**
+ * @brief Note where the pointer has moved to during a drag.
+ *
+ * @param me The motion event.
+ */
+void drag_motion(xcb_motion_notify_event_t *me)
+{
+	if (drag.win == XCB_NONE)
+		return;
+	drag.x = me->root_x;
+	drag.y = me->root_y;
+	drag.pending = true;
+}
+
+/**
+ * @brief Finish a drag, leaving the client where the pointer was released.
+ *
+ * @param re The button release event.
+ */
+void drag_end(xcb_button_release_event_t *re)
+{
+	if (drag.win == XCB_NONE)
+		return;
+	drag.x = re->root_x;
+	drag.y = re->root_y;
+	drag_apply();
+	drag.win = XCB_NONE;
+}
+
+/**
+ * @brief Configure the dragged client if the pointer has moved and enough
+ * time has passed since the last configure. This should be called once the
+ * queue of events has been drained.
+ */
+void drag_flush(void)
+{
+	if (drag.win == XCB_NONE || !drag.pending)
+		return;
+	if (conf.drag_rate
+			&& stats_now_us() - drag.last_us < 1000000 / conf.drag_rate)
+		return;
+	drag_apply();
+}
+
+/**
+ * @brief Find how long the main loop can wait before a delayed configure is
+ * due.
+ *
+ * @param tv Where to store the time to wait.
+ *
+ * @return False if nothing is delayed, so the main loop can wait forever.
+ */
+bool drag_timeout(struct timeval *tv)
+{
+	uint64_t wait_us, since;
+
+	if (drag.win == XCB_NONE || !drag.pending || !conf.drag_rate)
+		return false;
+	since = stats_now_us() - drag.last_us;
+	wait_us = since < 1000000 / conf.drag_rate
+		? 1000000 / conf.drag_rate - since : 0;
+	tv->tv_sec = wait_us / 1000000;
+	tv->tv_usec = wait_us % 1000000;
+	return true;
+}
@@ -0,0 +1,30 @@
+#ifndef DRAG_H
+#define DRAG_H
+
+#include <stdbool.h>
+#include <sys/time.h>
+#include <xcb/xcb.h>
+
+/**
+ * @file drag.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The button that moves a floating client when dragged. */
+#define DRAG_MOVE_BUTTON XCB_BUTTON_INDEX_1
+/** The button that resizes a floating client when dragged. */
+#define DRAG_RESIZE_BUTTON XCB_BUTTON_INDEX_3
+
+void drag_grab(void);
+bool drag_start(xcb_button_press_event_t *be);
+void drag_motion(xcb_motion_notify_event_t *me);
+void drag_end(xcb_button_release_event_t *re);
+void drag_flush(void);
+bool drag_timeout(struct timeval *tv);
+
+#endif
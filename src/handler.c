@@ -1,18 +1,30 @@
+#define LOG_SUBSYS LOG_HANDLER
+
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_ewmh.h>
-#include <xcb/xcb_icccm.h>
 #include <xcb/xproto.h>
 
+#include "backend.h"
 #include "client.h"
+#include "configure.h"
+#include "drag.h"
 #include "handler.h"
 #include "helper.h"
 #include "howm.h"
+#include "keys.h"
 #include "layout.h"
 #include "location.h"
 #include "monitor.h"
+#include "process.h"
+#include "record.h"
+#include "scratchpad.h"
+#include "stats.h"
+#include "sticky.h"
+#include "tabs.h"
+#include "trace.h"
 #include "types.h"
 #include "workspace.h"
 #include "xcb_help.h"
@@ -30,12 +42,35 @@
 static void enter_event(xcb_generic_event_t *ev);
 static void destroy_event(xcb_generic_event_t *ev);
 static void button_press_event(xcb_generic_event_t *ev);
+static void button_release_event(xcb_generic_event_t *ev);
+static void motion_event(xcb_generic_event_t *ev);
 static void map_event(xcb_generic_event_t *ev);
 static void configure_event(xcb_generic_event_t *ev);
 static void unmap_event(xcb_generic_event_t *ev);
 static void client_message_event(xcb_generic_event_t *ev);
+static void key_press_event(xcb_generic_event_t *ev);
+static void mapping_event(xcb_generic_event_t *ev);
+static void expose_event(xcb_generic_event_t *ev);
+static void property_event(xcb_generic_event_t *ev);
 static void unhandled_event(xcb_generic_event_t *ev);
 
+/** The names that X traffic is accounted under, indexed by event type. */
+static const char *event_names[] = {
+	[XCB_BUTTON_PRESS] = "button_press",
+	[XCB_BUTTON_RELEASE] = "button_release",
+	[XCB_MOTION_NOTIFY] = "motion_notify",
+	[XCB_MAP_REQUEST] = "map_request",
+	[XCB_DESTROY_NOTIFY] = "destroy_notify",
+	[XCB_ENTER_NOTIFY] = "enter_notify",
+	[XCB_CONFIGURE_REQUEST] = "configure_request",
+	[XCB_UNMAP_NOTIFY] = "unmap_notify",
+	[XCB_CLIENT_MESSAGE] = "client_message",
+	[XCB_KEY_PRESS] = "key_press",
+	[XCB_MAPPING_NOTIFY] = "mapping_notify",
+	[XCB_EXPOSE] = "expose",
+	[XCB_PROPERTY_NOTIFY] = "property_notify"
+};
+
 /**
  * @brief Process a button press.
  *
@@ -46,13 +81,17 @@ static void button_press_event(xcb_generic_event_t *ev)
 	/* FIXME: be->event doesn't seem to match with any windows managed by howm.*/
 	xcb_button_press_event_t *be = (xcb_button_press_event_t *)ev;
 
-	log_info("Button %d pressed at (%d, %d)", be->detail, be->event_x, be->event_y);
+	TRACE(TR_BUTTON, be->detail, be->event_x, be->event_y);
+	if (tabs_click(be))
+		return;
+	if (drag_start(be))
+		return;
 	if (conf.focus_mouse_click && be->detail == XCB_BUTTON_INDEX_1)
 		focus_window(be->event);
 
 	if (conf.focus_mouse_click) {
-		xcb_allow_events(dpy, XCB_ALLOW_REPLAY_POINTER, be->time);
-		xcb_flush(dpy);
+		xb->allow_events(be->time);
+		xb->flush();
 	}
 }
 
@@ -68,68 +107,50 @@ static void button_press_event(xcb_generic_event_t *ev)
  */
 static void map_event(xcb_generic_event_t *ev)
 {
-	xcb_window_t transient = 0;
-	xcb_get_geometry_reply_t *geom;
-	xcb_get_window_attributes_reply_t *wa;
 	xcb_map_request_event_t *me = (xcb_map_request_event_t *)ev;
-	xcb_ewmh_get_atoms_reply_t type;
-	unsigned int i;
+	struct xwin_info info;
 	client_t *c;
 	location_t loc;
 
-	wa = xcb_get_window_attributes_reply(dpy, xcb_get_window_attributes(dpy, me->window), NULL);
-	if (!wa || wa->override_redirect || loc_win(&loc, me->window)) {
-		free(wa);
+	if (loc_win(&loc, me->window)
+			|| !xb->get_window_info(me->window, &info)
+			|| info.override_redirect)
 		return;
-	}
-	free(wa);
+	record_window_info(me->window, &info);
 
-	log_info("Mapping request for window <0x%x>", me->window);
+	TRACE(TR_MAP, me->window);
+	if (info.pid)
+		process_mapped(info.pid, me->window);
 
-	c = create_client(me->window);
-
-	if (xcb_ewmh_get_wm_window_type_reply(ewmh,
-				xcb_ewmh_get_wm_window_type(ewmh, me->window),
-				&type, NULL) == 1) {
-		for (i = 0; i < type.atoms_len; i++) {
-			xcb_atom_t a = type.atoms[i];
-
-			if (a == ewmh->_NET_WM_WINDOW_TYPE_DOCK
-				|| a == ewmh->_NET_WM_WINDOW_TYPE_TOOLBAR) {
-				xcb_map_window(dpy, c->win);
-				remove_client(mon, mon->ws, c);
-				return;
-			} else if (a == ewmh->_NET_WM_WINDOW_TYPE_NOTIFICATION
-				|| a == ewmh->_NET_WM_WINDOW_TYPE_DROPDOWN_MENU
-				|| a == ewmh->_NET_WM_WINDOW_TYPE_SPLASH
-				|| a == ewmh->_NET_WM_WINDOW_TYPE_POPUP_MENU
-				|| a == ewmh->_NET_WM_WINDOW_TYPE_TOOLTIP
-				|| a == ewmh->_NET_WM_WINDOW_TYPE_DIALOG) {
-				c->is_floating = true;
-			}
-		}
+	/* Docks and toolbars are shown but not managed. */
+	if (info.is_dock) {
+		xb->map_window(me->window);
+		return;
 	}
 
+	c = create_client(me->window);
+	c->is_floating = info.wants_float;
+
 	/* Assume that transient windows MUST float. */
-	xcb_icccm_get_wm_transient_for_reply(dpy, xcb_icccm_get_wm_transient_for_unchecked(dpy, me->window), &transient, NULL);
-	c->is_transient = transient ? true : false;
+	c->is_transient = info.transient_for ? true : false;
 	if (c->is_transient)
 		c->is_floating = true;
 
-	geom = xcb_get_geometry_reply(dpy, xcb_get_geometry_unchecked(dpy, me->window), NULL);
-	if (geom) {
-		log_info("Mapped client's initial geom is %ux%u+%d+%d", geom->width, geom->height, geom->x, geom->y);
+	if (info.has_geom) {
+		TRACE(TR_MAP_GEOM, me->window, info.geom.width, info.geom.height,
+				info.geom.x, info.geom.y);
 		if (c->is_floating) {
-			c->rect.width = geom->width > 1 ? geom->width : conf.float_spawn_width;
-			c->rect.height = geom->height > 1 ? geom->height : conf.float_spawn_height;
-			c->rect.x = conf.center_floating ? (mon->rect.width / 2) - (c->rect.width / 2) : geom->x;
-			c->rect.y = conf.center_floating ? (mon->rect.height - mon->ws->bar_height - c->rect.height) / 2 : geom->y;
+			c->rect.width = info.geom.width > 1 ? info.geom.width : conf.float_spawn_width;
+			c->rect.height = info.geom.height > 1 ? info.geom.height : conf.float_spawn_height;
+			c->rect.x = conf.center_floating ? (mon->rect.width / 2) - (c->rect.width / 2) : info.geom.x;
+			c->rect.y = conf.center_floating ? (mon->rect.height - mon->ws->bar_height - c->rect.height) / 2 : info.geom.y;
 		}
-		free(geom);
 	}
 
 	arrange_windows(mon);
-	xcb_map_window(dpy, c->win);
+	/* Map the window at its final size, so it only draws itself once. */
+	configure_commit();
+	xb->map_window(c->win);
 	update_focused_client(c);
 	grab_buttons(c);
 }
@@ -147,14 +168,55 @@ static void destroy_event(xcb_generic_event_t *ev)
 {
 	xcb_destroy_notify_event_t *de = (xcb_destroy_notify_event_t *)ev;
 	location_t loc;
+	monitor_t *m;
+	client_t *c;
 
-	if (!loc_win(&loc, de->window))
+	if (!loc_win(&loc, de->window)) {
+		c = sticky_find(de->window, &m);
+		if (c)
+			sticky_remove(m, c);
+		else
+			scratchpad_destroy_win(de->window);
 		return;
-	log_info("Client <%p> wants to be destroyed", loc.c);
+	}
+	TRACE(TR_DESTROY, (uintptr_t)loc.c);
 	remove_client(loc.mon, loc.ws, loc.c);
 	arrange_windows(loc.mon);
 }
 
+/**
+ * @brief Check whether a crossing was caused by howm moving windows, rather
+ * than by the pointer moving.
+ *
+ * A crossing is ignored if it was generated before the X server had processed
+ * the marker that follows howm's last maps, unmaps, configures and warps, or
+ * if the pointer is where it was at the last crossing. Otherwise focusing a window under a
+ * still pointer can cause a relayout, which causes another crossing.
+ *
+ * @param ev The enter event.
+ *
+ * @return True if the crossing should be ignored.
+ */
+static bool is_wm_crossing(xcb_generic_event_t *ev)
+{
+	xcb_enter_notify_event_t *ee = (xcb_enter_notify_event_t *)ev;
+	static bool seen;
+	static int16_t last_x, last_y;
+	bool still = seen && ee->root_x == last_x && ee->root_y == last_y;
+
+	seen = true;
+	last_x = ee->root_x;
+	last_y = ee->root_y;
+
+	if (ee->mode != XCB_NOTIFY_MODE_NORMAL
+			|| ee->detail == XCB_NOTIFY_DETAIL_INFERIOR)
+		return true;
+	/* full_sequence is the last request processed before the event, so a
+	 * crossing caused by howm comes before the marker that follows its
+	 * layout requests. */
+	return still || (int32_t)(ev->full_sequence - xb->layout_seq()) < 0;
+}
+
 /**
  * @brief The event that occurs when the mouse pointer enters a window.
  *
@@ -168,7 +230,11 @@ static void enter_event(xcb_generic_event_t *ev)
 	 */
 	xcb_point_t point = {ee->root_x, ee->root_y};
 
-	log_debug("Enter event for window <0x%x>", ee->event);
+	TRACE(TR_ENTER, ee->event);
+	if (is_wm_crossing(ev)) {
+		log_debug("Ignoring crossing into 0x%x caused by howm", ee->event);
+		return;
+	}
 
 	focus_monitor(point_to_monitor(point));
 
@@ -179,17 +245,26 @@ static void enter_event(xcb_generic_event_t *ev)
 /**
  * @brief Deal with a window's request to change its geometry.
  *
- * @param ev The event sent from the window.
+ * The ConfigureNotify events that follow howm's own configures aren't
+ * handled, so they can't cause another arrange.
+ *
+ * @param ev The ConfigureRequest sent from the window.
  */
 static void configure_event(xcb_generic_event_t *ev)
 {
 	xcb_configure_request_event_t *ce = (xcb_configure_request_event_t *)ev;
 	uint32_t vals[7] = {0}, i = 0;
 	location_t loc;
+	client_t *fs;
 	bool found;
 
 	found = loc_win(&loc, ce->window);
-	log_info("Received configure request for window <0x%x>", ce->window);
+	TRACE(TR_CONFIGURE, ce->window, ce->width, ce->height, ce->x, ce->y);
+	fs = found ? fullscreen_client(loc.ws) : NULL;
+	/* Clients hidden by a fullscreen client are arranged once it stops
+	 * hiding them. */
+	if (fs && fs != loc.c)
+		return;
 
 	/* TODO: Need to test whether gaps etc need to be taken into account
 	 * here. */
@@ -207,7 +282,7 @@ static void configure_event(xcb_generic_event_t *ev)
 		vals[i++] = ce->sibling;
 	if (XCB_CONFIG_WINDOW_STACK_MODE & ce->value_mask)
 		vals[i++] = ce->stack_mode;
-	xcb_configure_window(dpy, ce->window, ce->value_mask, vals);
+	queue_configure(ce->window, ce->value_mask, vals);
 	if (found)
 		arrange_windows(loc.mon);
 }
@@ -221,11 +296,17 @@ static void unmap_event(xcb_generic_event_t *ev)
 {
 	xcb_unmap_notify_event_t *ue = (xcb_unmap_notify_event_t *)ev;
 	location_t loc;
+	monitor_t *m;
+	client_t *c;
 
-	if (!loc_win(&loc, ue->window))
+	if (!loc_win(&loc, ue->window)) {
+		c = sticky_find(ue->window, &m);
+		if (c && ue->event != screen->root)
+			sticky_remove(m, c);
 		return;
+	}
 
-	log_info("Received unmap request for client <%p>", loc.c);
+	TRACE(TR_UNMAP, (uintptr_t)loc.c);
 
 	if (ue->event != screen->root) {
 		remove_client(loc.mon, loc.ws, loc.c);
@@ -234,6 +315,25 @@ static void unmap_event(xcb_generic_event_t *ev)
 	howm_info();
 }
 
+/**
+ * @brief Handle a sticky client asking to stop being sticky. Its other states
+ * are left alone, as it isn't on a workspace.
+ *
+ * @param cm The client message.
+ */
+static void sticky_message(xcb_client_message_event_t *cm)
+{
+	client_t *c = sticky_find(cm->window, NULL);
+	unsigned int i;
+
+	if (!c || cm->type != ewmh->_NET_WM_STATE)
+		return;
+	for (i = 1; i <= 2; i++)
+		if (cm->data.data32[i] == ewmh->_NET_WM_STATE_STICKY)
+			ewmh_process_wm_state(c, ewmh->_NET_WM_STATE_STICKY,
+					cm->data.data32[0]);
+}
+
 /**
  * @brief Handle messages sent by the client to alter its state.
  *
@@ -250,8 +350,10 @@ static void client_message_event(xcb_generic_event_t *ev)
 		change_ws(index_to_workspace(mon, cm->data.data32[0]));
 	}
 
-	if (!loc_win(&loc, cm->window))
+	if (!loc_win(&loc, cm->window)) {
+		sticky_message(cm);
 		return;
+	}
 
 	if (cm->type == ewmh->_NET_WM_STATE) {
 		ewmh_process_wm_state(loc.c, (xcb_atom_t) cm->data.data32[1], cm->data.data32[0]);
@@ -265,24 +367,128 @@ static void client_message_event(xcb_generic_event_t *ev)
 		log_info("_NET_ACTIVE_WINDOW: Focusing client <%p>", loc.c);
 		update_focused_client(loc.c);
 	} else {
-		log_debug("Unhandled client message: %d", cm->type);
+		TRACE(TR_CLIENT_MSG, cm->window, cm->type);
 	}
 }
 
+/**
+ * @brief Finish dragging a client.
+ *
+ * @param ev The button release event.
+ */
+static void button_release_event(xcb_generic_event_t *ev)
+{
+	drag_end((xcb_button_release_event_t *)ev);
+}
+
+/**
+ * @brief The pointer has moved while dragging a client. The client isn't
+ * configured until the event queue is empty, see drag_flush().
+ *
+ * @param ev The motion event.
+ */
+static void motion_event(xcb_generic_event_t *ev)
+{
+	drag_motion((xcb_motion_notify_event_t *)ev);
+}
+
+/**
+ * @brief Call the function that a key is bound to.
+ *
+ * @param ev The key press event.
+ */
+static void key_press_event(xcb_generic_event_t *ev)
+{
+	key_press((xcb_key_press_event_t *)ev);
+}
+
+/**
+ * @brief The keyboard mapping has changed, so the keys that produce each
+ * binding may have too.
+ *
+ * @param ev The mapping notify event.
+ */
+static void mapping_event(xcb_generic_event_t *ev)
+{
+	xcb_mapping_notify_event_t *me = (xcb_mapping_notify_event_t *)ev;
+
+	if (me->request == XCB_MAPPING_POINTER)
+		return;
+	xb->refresh_keymap(me);
+	grab_keys();
+}
+
 static void unhandled_event(xcb_generic_event_t *ev)
 {
-	/* If we have a LOG_LEVEL higher than LOG_DEBUG, then we will
-	 * get compiler warnings about ev not being used. */
+	/* Unhandled events are already in the trace, as event "unhandled". */
 	UNUSED(ev);
-	log_debug("Unhandled event: %d", ev->response_type & ~0x80);
 }
 
+/**
+ * @brief Redraw a tab strip that has been exposed.
+ *
+ * @param ev The expose event.
+ */
+static void expose_event(xcb_generic_event_t *ev)
+{
+	tabs_expose((xcb_expose_event_t *)ev);
+}
+
+/**
+ * @brief Redraw the tab of a client that has changed its title.
+ *
+ * Property changes are only selected on clients while a workspace uses the
+ * tabbed layout.
+ *
+ * @param ev The property notify event.
+ */
+static void property_event(xcb_generic_event_t *ev)
+{
+	xcb_property_notify_event_t *pe = (xcb_property_notify_event_t *)ev;
+	location_t loc;
+
+	if (pe->atom != XCB_ATOM_WM_NAME && pe->atom != ewmh->_NET_WM_NAME)
+		return;
+	if (!loc_win(&loc, pe->window))
+		return;
+	tabs_title_changed(loc.mon, loc.ws, loc.c);
+}
+
+/**
+ * @brief Find the name of an event, as used when accounting X traffic.
+ *
+ * @param type The event's response type.
+ *
+ * @return The name of the event.
+ */
+static const char *event_name(uint8_t type)
+{
+	if (type < LENGTH(event_names) && event_names[type])
+		return event_names[type];
+	return "unhandled";
+}
+
+/**
+ * @brief Pass an event on to the appropriate handler.
+ *
+ * @param ev The event to be handled.
+ */
 void handle_event(xcb_generic_event_t *ev)
 {
-	switch (ev->response_type & ~0x80) {
+	uint8_t type = ev->response_type & ~0x80;
+
+	stats_begin(event_name(type));
+	trace_str(TR_EVENT, event_name(type), ev->sequence);
+	switch (type) {
 	case XCB_BUTTON_PRESS:
 		button_press_event(ev);
 		break;
+	case XCB_BUTTON_RELEASE:
+		button_release_event(ev);
+		break;
+	case XCB_MOTION_NOTIFY:
+		motion_event(ev);
+		break;
 	case XCB_MAP_REQUEST:
 		map_event(ev);
 		break;
@@ -292,7 +498,7 @@ void handle_event(xcb_generic_event_t *ev)
 	case XCB_ENTER_NOTIFY:
 		enter_event(ev);
 		break;
-	case XCB_CONFIGURE_NOTIFY:
+	case XCB_CONFIGURE_REQUEST:
 		configure_event(ev);
 		break;
 	case XCB_UNMAP_NOTIFY:
@@ -301,8 +507,21 @@ void handle_event(xcb_generic_event_t *ev)
 	case XCB_CLIENT_MESSAGE:
 		client_message_event(ev);
 		break;
+	case XCB_KEY_PRESS:
+		key_press_event(ev);
+		break;
+	case XCB_MAPPING_NOTIFY:
+		mapping_event(ev);
+		break;
+	case XCB_EXPOSE:
+		expose_event(ev);
+		break;
+	case XCB_PROPERTY_NOTIFY:
+		property_event(ev);
+		break;
 	default:
 		unhandled_event(ev);
 		break;
 	}
+	stats_end();
 }
@@ -3,6 +3,8 @@
 
 #include <stdio.h>
 
+#include "log.h"
+
 /**
  * @file helper.h
  *
@@ -29,55 +31,7 @@
 /** Determine which file descriptor is the largest and add one to it. */
 #define MAX_FD(x, y) ((x) > (y) ? (x + 1) : (y + 1))
 
-/** How much detail should be logged. A LOG_LEVEL of INFO will log almost
- * everything, LOG_WARN will log warnings and errors and LOG_ERR will log only
- * errors.
- *
- * LOG_NONE means nothing will be logged.
- *
- * LOG_DEBUG should be used by developers.
- */
-#define LOG_LEVEL LOG_DEBUG
-
 /** Enable debugging output */
 #define DEBUG_ENABLE false
 
-/* Add comments so that splint ignores this as it doesn't support variadic
- * macros.
- */
-/*@ignore@*/
-
-#define LOG_DEBUG 1
-#define LOG_INFO 2
-#define LOG_WARN 3
-#define LOG_ERR 4
-#define LOG_NONE 5
-
-#if LOG_LEVEL == LOG_DEBUG
-#define log_debug(M, ...) fprintf(stderr, "[DEBUG] (%s:%d) " M "\n", __FILE__, __LINE__, ##__VA_ARGS__)
-#else
-#define log_debug(x, ...) do {} while (0)
-#endif
-
-
-#if LOG_LEVEL <= LOG_INFO
-#define log_info(M, ...) fprintf(stderr, "[INFO] (%s:%d) " M "\n", __FILE__, __LINE__, ##__VA_ARGS__)
-#else
-#define log_info(x, ...) do {} while (0)
-#endif
-
-#if LOG_LEVEL <= LOG_WARN
-#define log_warn(M, ...) fprintf(stderr, "[WARN] (%s:%d) " M "\n", __FILE__, __LINE__, ##__VA_ARGS__)
-#else
-#define log_warn(x, ...) do {} while (0)
-#endif
-
-#if LOG_LEVEL <= LOG_ERR
-#define log_err(M, ...) fprintf(stderr, "[ERROR] (%s:%d) " M "\n", __FILE__, __LINE__, ##__VA_ARGS__)
-#else
-#define log_err(x, ...) do {} while (0)
-#endif
-/*@end@*/
-
-
 #endif
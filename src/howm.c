@@ -1,3 +1,5 @@
+#define LOG_SUBSYS LOG_CORE
+
 #include <errno.h>
 #include <getopt.h>
 #include <stdbool.h>
@@ -10,12 +12,20 @@
 #include <xcb/randr.h>
 #include <xcb/xcb_ewmh.h>
 
+#include "backend.h"
+#include "configure.h"
+#include "drag.h"
 #include "handler.h"
 #include "helper.h"
 #include "howm.h"
 #include "ipc.h"
+#include "keys.h"
 #include "monitor.h"
+#include "process.h"
+#include "record.h"
 #include "scratchpad.h"
+#include "stats.h"
+#include "trace.h"
 #include "xcb_help.h"
 #include "workspace.h"
 
@@ -41,6 +51,24 @@
 static void setup(void);
 static void cleanup(void);
 static void exec_config(char *conf_path);
+static void colour_init(void);
+
+/**
+ * @brief A colour that has been allocated from the default colourmap.
+ */
+struct colour_entry {
+	uint32_t rgb; /**< The colour, as 0xRRGGBB. */
+	uint32_t pixel; /**< The pixel that X allocated for it. */
+};
+
+/** Whether pixels can be calculated from the root visual's masks. */
+static bool true_colour;
+static uint32_t red_mask, green_mask, blue_mask;
+/** Allocated colours, used when the visual isn't TrueColor. */
+static struct colour_entry colour_cache[COLOUR_CACHE_LEN];
+/** The amount of colours ever cached, the next is stored at
+ * nr_cached_colours % COLOUR_CACHE_LEN. */
+static unsigned int nr_cached_colours;
 
 struct config conf = {
 	.focus_mouse = false,
@@ -61,13 +89,18 @@ struct config conf = {
 	.delete_register_size = 5,
 	.scratchpad_height = 500,
 	.scratchpad_width = 500,
+	.slow_event_us = 5000,
+	.drag_mods = XCB_MOD_MASK_4,
+	.drag_rate = 60,
+	.tab_height = 16,
 };
 
 bool running = true;
 xcb_connection_t *dpy = NULL;
 xcb_screen_t *screen = NULL;
 xcb_ewmh_connection_t *ewmh = NULL;
-const char *WM_ATOM_NAMES[] = { "WM_DELETE_WINDOW", "WM_PROTOCOLS" };
+const char *WM_ATOM_NAMES[] = { "WM_DELETE_WINDOW", "WM_PROTOCOLS",
+	"_NET_WM_BYPASS_COMPOSITOR" };
 xcb_atom_t wm_atoms[LENGTH(WM_ATOM_NAMES)];
 
 int retval = EXIT_FAILURE;
@@ -95,6 +128,10 @@ monitor_t *mon_tail = NULL;
  */
 static void setup(void)
 {
+	char *colours[] = { DEF_BORDER_FOCUS, DEF_BORDER_UNFOCUS,
+		DEF_BORDER_PREV_FOCUS, DEF_BORDER_URGENT };
+	uint32_t pixels[LENGTH(colours)];
+
 	screen = xcb_setup_roots_iterator(xcb_get_setup(dpy)).data;
 	if (!screen) {
 		log_err("Can't acquire the default screen.");
@@ -104,18 +141,21 @@ static void setup(void)
 	screen_height = screen->height_in_pixels;
 	screen_width = screen->width_in_pixels;
 
-	get_atoms(WM_ATOM_NAMES, wm_atoms);
+	get_atoms(WM_ATOM_NAMES, wm_atoms, LENGTH(wm_atoms));
 	setup_ewmh();
 	scan_monitors();
 	setup_ewmh_geom();
 
 	xcb_prefetch_extension_data(dpy, &xcb_randr_id);
 
-	conf.border_focus = get_colour(DEF_BORDER_FOCUS);
-	conf.border_unfocus = get_colour(DEF_BORDER_UNFOCUS);
-	conf.border_prev_focus = get_colour(DEF_BORDER_PREV_FOCUS);
-	conf.border_urgent = get_colour(DEF_BORDER_URGENT);
-	stack_init(&del_reg);
+	colour_init();
+	get_colours(colours, pixels, LENGTH(colours));
+	conf.border_focus = pixels[0];
+	conf.border_unfocus = pixels[1];
+	conf.border_prev_focus = pixels[2];
+	conf.border_urgent = pixels[3];
+	stack_init(&del_reg, conf.delete_register_size);
+	trace_init();
 
 	howm_info();
 }
@@ -126,30 +166,37 @@ static void setup(void)
 int main(int argc, char *argv[])
 {
 	fd_set descs;
-	int sock_fd, dpy_fd, cmd_fd, ret;
-	ssize_t n;
+	struct timeval tv;
+	int sock_fd, dpy_fd, sig_fd, nfds;
 	xcb_generic_event_t *ev;
 	char ch;
 	char conf_path[128] = {0};
-	char *data = calloc(IPC_BUF_SIZE, sizeof(char));
-
-	if (!data) {
-		log_err("Can't allocate memory for socket buffer.");
-		exit(EXIT_FAILURE);
-	}
+	char record_path[128] = {0};
+	char replay_path[128] = {0};
+	bool use_mock = false;
+	uint16_t w, h;
 
 	conf_path[0] = '\0';
 
-	while ((ch = getopt(argc, argv, "vhc:")) != -1) {
+	while ((ch = getopt(argc, argv, "vhc:r:p:m")) != -1) {
 		switch (ch) {
 		case 'c':
 			snprintf(conf_path, sizeof(conf_path), "%s", optarg);
 			break;
+		case 'r':
+			snprintf(record_path, sizeof(record_path), "%s", optarg);
+			break;
+		case 'p':
+			snprintf(replay_path, sizeof(replay_path), "%s", optarg);
+			break;
+		case 'm':
+			use_mock = true;
+			break;
 		case 'v':
 			printf("%s\n", VERSION);
 			exit(EXIT_SUCCESS);
 		case 'h':
-			printf("%s: %s", WM_NAME, "[-v|-h|-c CONFIG_PATH]\n");
+			printf("%s: %s", WM_NAME, "[-v|-h|-c CONFIG_PATH|-r RECORDING|-p RECORDING -m]\n");
 			exit(EXIT_SUCCESS);
 		}
 	}
@@ -160,45 +207,67 @@ int main(int argc, char *argv[])
 		log_err("Using default config path: %s", conf_path);
 	}
 
+	if (replay_path[0] != '\0') {
+		/* The recorded windows don't exist on a real X server, so only
+		 * the mock backend can answer for them. */
+		if (!use_mock) {
+			log_err("Recordings can only be replayed with -m");
+			exit(EXIT_FAILURE);
+		}
+		if (!replay_open(replay_path, &w, &h))
+			exit(EXIT_FAILURE);
+		/* There is no X connection to clean up. */
+		mock_backend_init(w, h);
+		replay_run();
+		return EXIT_SUCCESS;
+	}
+
 	dpy = xcb_connect(NULL, NULL);
 	if (xcb_connection_has_error(dpy)) {
 		log_err("Can't open X connection");
 		exit(EXIT_FAILURE);
 	}
 
+	set_cloexec(xcb_get_file_descriptor(dpy));
 	setup();
+	if (record_path[0] != '\0' && !record_open(record_path))
+		exit(EXIT_FAILURE);
 	sock_fd = ipc_init();
+	sig_fd = process_init();
 	check_other_wm();
+	drag_grab();
 	dpy_fd = xcb_get_file_descriptor(dpy);
 	exec_config(conf_path);
 
 	while (running) {
+		configure_commit();
+		xb->mark_layout();
 		if (!xcb_flush(dpy))
 			log_err("Failed to flush X connection");
 
 		FD_ZERO(&descs);
 		FD_SET(dpy_fd, &descs);
 		FD_SET(sock_fd, &descs);
-
-		if (select(MAX_FD(dpy_fd, sock_fd), &descs, NULL, NULL, NULL) > 0) {
-			if (FD_ISSET(sock_fd, &descs)) {
-				cmd_fd = accept(sock_fd, NULL, 0);
-				if (cmd_fd == -1) {
-					log_err("Failed to accept connection");
-					continue;
-				}
-				n = read(cmd_fd, data, IPC_BUF_SIZE - 1);
-				if (n > 0) {
-					data[n] = '\0';
-					ret = ipc_process(data, n);
-					if (write(cmd_fd, &ret, sizeof(int)) == -1)
-						log_err("Unable to send response. errno: %d", errno);
-				}
-			}
+		nfds = MAX_FD(dpy_fd, sock_fd);
+		if (sig_fd != -1) {
+			FD_SET(sig_fd, &descs);
+			nfds = MAX_FD(nfds - 1, sig_fd);
+		}
+		nfds = ipc_set_fds(&descs, nfds);
+
+		if (select(nfds, &descs, NULL, NULL,
+					drag_timeout(&tv) ? &tv : NULL) > 0) {
+			if (sig_fd != -1 && FD_ISSET(sig_fd, &descs))
+				process_reap();
+			ipc_read_sessions(&descs);
+			if (FD_ISSET(sock_fd, &descs))
+				ipc_accept(sock_fd);
 			if (FD_ISSET(dpy_fd, &descs)) {
 				while ((ev = xcb_poll_for_event(dpy)) != NULL) {
-					if (ev)
+					if (ev) {
+						record_event(ev);
 						handle_event(ev);
+					}
 					else
 						log_debug("Unimplemented event: %d", ev->response_type & ~0x80);
 					free(ev);
@@ -209,14 +278,20 @@ int main(int argc, char *argv[])
 				running = false;
 			}
 		}
+		drag_flush();
+		record_flush();
+		if (trace_dump_pending) {
+			trace_dump_pending = 0;
+			trace_dump(stderr);
+		}
 	}
 
 	cleanup();
 	close(sock_fd);
-	free(data);
+	if (sig_fd != -1)
+		close(sig_fd);
 
-	if (!running)
-		return retval;
+	return retval;
 }
 
 /**
@@ -257,16 +332,143 @@ static void cleanup(void)
 	while (mon)
 		remove_monitor(mon);
 
-	xcb_set_input_focus(dpy, XCB_INPUT_FOCUS_POINTER_ROOT, screen->root,
-			XCB_CURRENT_TIME);
+	xb->set_input_focus(screen->root);
 	xcb_ewmh_connection_wipe(ewmh);
 	if (ewmh)
 		free(ewmh);
 	stack_free(&del_reg);
+	scratchpad_free_all();
+	keys_cleanup();
+	configure_cleanup();
+	record_close();
 	ipc_cleanup();
 	xcb_disconnect(dpy);
 }
 
+/**
+ * @brief Find the root visual and, if it is TrueColor, remember its masks so
+ * that pixels can be calculated without asking the X server.
+ */
+static void colour_init(void)
+{
+	xcb_depth_iterator_t d = xcb_screen_allowed_depths_iterator(screen);
+	xcb_visualtype_iterator_t v;
+
+	for (; d.rem; xcb_depth_next(&d)) {
+		v = xcb_depth_visuals_iterator(d.data);
+		for (; v.rem; xcb_visualtype_next(&v)) {
+			if (v.data->visual_id != screen->root_visual)
+				continue;
+			true_colour = v.data->_class == XCB_VISUAL_CLASS_TRUE_COLOR;
+			red_mask = v.data->red_mask;
+			green_mask = v.data->green_mask;
+			blue_mask = v.data->blue_mask;
+			log_info("Root visual is %sTrueColor",
+					true_colour ? "" : "not ");
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Scale a colour component to fit a TrueColor mask.
+ *
+ * @param value The component, from 0 to 0xFF.
+ * @param mask The mask of the component in a pixel.
+ *
+ * @return The component's bits of the pixel.
+ */
+static uint32_t colour_component(uint32_t value, uint32_t mask)
+{
+	unsigned int shift = 0, bits = 0;
+
+	if (!mask)
+		return 0;
+	for (; !(mask & 1); mask >>= 1)
+		shift++;
+	for (; mask & 1; mask >>= 1)
+		bits++;
+	/* Widen to 16 bits, as X does, before dropping what doesn't fit. */
+	value *= 257;
+	return (bits < 16 ? value >> (16 - bits) : value) << shift;
+}
+
+/**
+ * @brief Look up a colour that has already been allocated.
+ *
+ * @param rgb The colour, as 0xRRGGBB.
+ * @param pixel Where to store the pixel, if found.
+ *
+ * @return True if the colour was found.
+ */
+static bool colour_cache_find(uint32_t rgb, uint32_t *pixel)
+{
+	unsigned int i, n = nr_cached_colours < COLOUR_CACHE_LEN
+		? nr_cached_colours : COLOUR_CACHE_LEN;
+
+	for (i = 0; i < n; i++) {
+		if (colour_cache[i].rgb == rgb) {
+			*pixel = colour_cache[i].pixel;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Converts hexcode colours into X11 colourmap pixels.
+ *
+ * On a TrueColor visual the pixels are calculated directly. Otherwise any
+ * colours that haven't been seen before are allocated, with every request
+ * sent before any reply is waited for.
+ *
+ * @param colours Strings of the format "#RRGGBB".
+ * @param pixels Where to store the pixel of each colour. A colour that can't
+ * be allocated gets a pixel of 0.
+ * @param n The amount of colours.
+ */
+void get_colours(char **colours, uint32_t *pixels, unsigned int n)
+{
+	xcb_alloc_color_cookie_t cookies[n];
+	xcb_alloc_color_reply_t *rep;
+	uint32_t rgb[n];
+	bool sent[n];
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		rgb[i] = strtol(colours[i] + 1, NULL, 16) & 0xFFFFFF;
+		sent[i] = false;
+		if (true_colour) {
+			pixels[i] = colour_component(rgb[i] >> 16, red_mask)
+				| colour_component((rgb[i] >> 8) & 0xFF, green_mask)
+				| colour_component(rgb[i] & 0xFF, blue_mask);
+		} else if (!colour_cache_find(rgb[i], &pixels[i])) {
+			cookies[i] = XREQ(xcb_alloc_color(dpy,
+				screen->default_colormap,
+				(rgb[i] >> 16) * 257, ((rgb[i] >> 8) & 0xFF) * 257,
+				(rgb[i] & 0xFF) * 257));
+			sent[i] = true;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		if (!sent[i])
+			continue;
+		stats_wait_begin();
+		rep = xcb_alloc_color_reply(dpy, cookies[i], NULL);
+		stats_wait_end();
+		if (!rep) {
+			log_err("ERROR: Can't allocate the colour %s", colours[i]);
+			pixels[i] = 0;
+			continue;
+		}
+		pixels[i] = rep->pixel;
+		colour_cache[nr_cached_colours++ % COLOUR_CACHE_LEN] =
+			(struct colour_entry) { rgb[i], rep->pixel };
+		free(rep);
+	}
+}
+
 /**
  * @brief Converts a hexcode colour into an X11 colourmap pixel.
  *
@@ -278,23 +480,8 @@ static void cleanup(void)
 uint32_t get_colour(char *colour)
 {
 	uint32_t pixel;
-	uint16_t r, g, b;
-	xcb_alloc_color_reply_t *rep;
-	xcb_colormap_t map = screen->default_colormap;
 
-	long int rgb = strtol(++colour, NULL, 16);
-
-	r = ((rgb >> 16) & 0xFF) * 257;
-	g = ((rgb >> 8) & 0xFF) * 257;
-	b = (rgb & 0xFF) * 257;
-	rep = xcb_alloc_color_reply(dpy, xcb_alloc_color(dpy, map,
-				    r, g, b), NULL);
-	if (!rep) {
-		log_err("ERROR: Can't allocate the colour %s", colour);
-		return 0;
-	}
-	pixel = rep->pixel;
-	free(rep);
+	get_colours(&colour, &pixel, 1);
 	return pixel;
 }
 
@@ -305,11 +492,10 @@ uint32_t get_colour(char *colour)
  */
 static void exec_config(char *conf_path)
 {
-	if (fork())
-		return;
-	setsid();
-	execl(conf_path, conf_path, NULL);
-	log_err("Couldn't execute the configuration file %s", conf_path);
+	char *argv[] = { conf_path, NULL };
+
+	if (process_spawn(argv) == -1)
+		log_err("Couldn't execute the configuration file %s", conf_path);
 }
 
 /**
@@ -333,13 +519,6 @@ void quit(const int exit_status)
  */
 void spawn(char *cmd[])
 {
-	if (fork())
-		return;
-	if (dpy)
-		close(screen->root);
-	setsid();
-	log_info("Spawning command: %s", (char *)cmd[0]);
-	execvp((char *)cmd[0], (char **)cmd);
-	log_err("execvp of command: %s failed.", (char *)cmd[0]);
-	exit(EXIT_FAILURE);
+	log_info("Spawning command: %s", cmd[0]);
+	process_spawn(cmd);
 }
@@ -24,7 +24,11 @@
 #define DEF_BORDER_UNFOCUS "#333333"
 #define DEF_BORDER_PREV_FOCUS "#444444"
 #define DEF_BORDER_URGENT "#FF0000"
+/** The core font that tab titles are drawn in. */
+#define TAB_FONT "fixed"
 #define GAP 0
+/** The most colours that are remembered, when they can't be calculated. */
+#define COLOUR_CACHE_LEN 16
 
 /**
  * @file howm.h
@@ -55,6 +59,10 @@ struct config {
 	unsigned int delete_register_size;
 	uint16_t scratchpad_height;
 	uint16_t scratchpad_width;
+	unsigned int slow_event_us;
+	uint16_t drag_mods;
+	unsigned int drag_rate;
+	uint16_t tab_height;
 };
 
 enum states { OPERATOR_STATE, COUNT_STATE, MOTION_STATE, END_STATE };
@@ -82,6 +90,7 @@ extern xcb_atom_t wm_atoms[];
 
 void howm_info(void);
 uint32_t get_colour(char *colour);
+void get_colours(char **colours, uint32_t *pixels, unsigned int n);
 void quit(const int exit_status);
 void spawn(char *cmd[]);
 
@@ -1,3 +1,9 @@
+#define _POSIX_C_SOURCE 200809L
+#define LOG_SUBSYS LOG_IPC
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <stdbool.h>
@@ -7,17 +13,23 @@
 #include <unistd.h>
 
 #include "client.h"
+#include "drag.h"
 #include "helper.h"
 #include "howm.h"
 #include "ipc.h"
+#include "keys.h"
 #include "layout.h"
 #include "monitor.h"
 #include "op.h"
+#include "process.h"
+#include "record.h"
 #include "scratchpad.h"
+#include "stats.h"
+#include "sticky.h"
+#include "trace.h"
 #include "types.h"
 #include "workspace.h"
-
-enum msg_type { MSG_FUNCTION = 1, MSG_CONFIG };
+#include "xcb_help.h"
 
 /**
  * @file ipc.c
@@ -35,6 +47,25 @@ static int ipc_arg_to_int(char *arg, int *err, int lower, int upper);
 static int ipc_process_function(char **args);
 static int ipc_process_config(char **args);
 static bool ipc_arg_to_bool(char *arg, int *err);
+static int ipc_process_query(char **args);
+
+/**
+ * @brief A connection that is kept open, so that a client can send many
+ * messages without reconnecting.
+ */
+struct ipc_session {
+	int fd; /**< The socket, or -1 if the slot is free. */
+	uint32_t len; /**< The amount of data in buf. */
+	char buf[sizeof(uint32_t) + IPC_BUF_SIZE]; /**< Data that has been
+						    read, but not processed. */
+};
+
+/** The text produced by the last query, sent after the error code. */
+static char *reply;
+static size_t reply_len;
+/** Whether the last message was a query, so needs the text sending. */
+static bool is_query;
+static struct ipc_session sessions[IPC_MAX_SESSIONS];
 
 /**
  * @brief Open a socket and return it.
@@ -50,6 +81,7 @@ int ipc_init(void)
 	char *sp = NULL;
 	char sock_path[256];
 	int sock_fd;
+	unsigned int i;
 
 	sp = getenv(ENV_SOCK_VAR);
 
@@ -68,6 +100,7 @@ int ipc_init(void)
 		log_err("Couldn't create the socket.");
 		exit(EXIT_FAILURE);
 	}
+	set_cloexec(sock_fd);
 
 	if (bind(sock_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
 		log_err("Couldn't bind a name to the socket.");
@@ -79,15 +112,189 @@ int ipc_init(void)
 		exit(EXIT_FAILURE);
 	}
 
+	for (i = 0; i < IPC_MAX_SESSIONS; i++)
+		sessions[i].fd = -1;
+
 	return sock_fd;
 }
 
 /**
- * @brief Delete the UNIX socket file.
+ * @brief Process a message and send the response.
+ *
+ * @param fd The socket that the message was read from.
+ * @param msg The message, which must be followed by a NUL.
+ * @param len The length of the message.
+ */
+static void ipc_handle(int fd, char *msg, int len)
+{
+	record_ipc(msg, len);
+	ipc_respond(fd, ipc_process(msg, len));
+}
+
+/**
+ * @brief Close a session and free its slot.
+ *
+ * @param s The session.
+ */
+static void ipc_close_session(struct ipc_session *s)
+{
+	log_info("Closing session on fd %d", s->fd);
+	close(s->fd);
+	s->fd = -1;
+	s->len = 0;
+}
+
+/**
+ * @brief Process every complete message that has been read from a session.
+ *
+ * @param s The session.
+ */
+static void ipc_drain_session(struct ipc_session *s)
+{
+	static char msg[IPC_BUF_SIZE];
+	uint32_t off = 0, len;
+
+	while (s->len - off >= sizeof(len)) {
+		memcpy(&len, s->buf + off, sizeof(len));
+		if (len == 0 || len >= IPC_BUF_SIZE) {
+			log_warn("Bad message length %u, closing session", len);
+			ipc_close_session(s);
+			return;
+		}
+		if (s->len - off - sizeof(len) < len)
+			break;
+		memcpy(msg, s->buf + off + sizeof(len), len);
+		msg[len] = '\0';
+		ipc_handle(s->fd, msg, len);
+		off += sizeof(len) + len;
+	}
+	memmove(s->buf, s->buf + off, s->len - off);
+	s->len -= off;
+}
+
+/**
+ * @brief Start a session on a connection, so that it is kept open.
+ *
+ * The client is sent IPC_ERR_NONE, or IPC_ERR_BUSY if there are already
+ * IPC_MAX_SESSIONS sessions.
+ *
+ * @param fd The connection.
+ * @param data Anything that was read after the MSG_SESSION message.
+ * @param len The length of data.
+ */
+static void ipc_open_session(int fd, const char *data, uint32_t len)
+{
+	struct ipc_session *s = NULL;
+	unsigned int i;
+
+	for (i = 0; i < IPC_MAX_SESSIONS && !s; i++)
+		if (sessions[i].fd == -1)
+			s = &sessions[i];
+	if (!s) {
+		log_warn("Too many sessions, refusing another");
+		ipc_respond(fd, IPC_ERR_BUSY);
+		close(fd);
+		return;
+	}
+
+	log_info("Opening session on fd %d", fd);
+	ipc_respond(fd, IPC_ERR_NONE);
+	s->fd = fd;
+	memcpy(s->buf, data, len);
+	s->len = len;
+	ipc_drain_session(s);
+}
+
+/**
+ * @brief Accept a connection and process the message that is sent on it.
+ *
+ * Usually the connection is closed once the response has been sent, but if
+ * the message is MSG_SESSION it is kept open for further messages.
+ *
+ * @param sock_fd The socket that howm is listening on.
+ */
+void ipc_accept(int sock_fd)
+{
+	static char data[IPC_BUF_SIZE];
+	int fd = accept(sock_fd, NULL, 0);
+	ssize_t n;
+
+	if (fd == -1) {
+		log_err("Failed to accept connection");
+		return;
+	}
+	set_cloexec(fd);
+	n = read(fd, data, IPC_BUF_SIZE - 1);
+	if (n >= 2 && data[0] == MSG_SESSION && data[1] == '\0') {
+		ipc_open_session(fd, data + 2, n - 2);
+		return;
+	}
+	if (n > 0) {
+		data[n] = '\0';
+		ipc_handle(fd, data, n);
+	}
+	close(fd);
+}
+
+/**
+ * @brief Add the socket of each session to a set, so that they can be waited
+ * on with select().
+ *
+ * @param fds The set.
+ * @param nfds The highest fd in the set, plus one.
+ *
+ * @return The highest fd in the set after the sessions are added, plus one.
+ */
+int ipc_set_fds(fd_set *fds, int nfds)
+{
+	unsigned int i;
+
+	for (i = 0; i < IPC_MAX_SESSIONS; i++) {
+		if (sessions[i].fd == -1)
+			continue;
+		FD_SET(sessions[i].fd, fds);
+		nfds = MAX_FD(nfds - 1, sessions[i].fd);
+	}
+	return nfds;
+}
+
+/**
+ * @brief Read from each session that is ready and process any messages that
+ * are complete.
+ *
+ * @param fds The set of fds that select() reported as readable.
+ */
+void ipc_read_sessions(fd_set *fds)
+{
+	struct ipc_session *s;
+	unsigned int i;
+	ssize_t n;
+
+	for (i = 0; i < IPC_MAX_SESSIONS; i++) {
+		s = &sessions[i];
+		if (s->fd == -1 || !FD_ISSET(s->fd, fds))
+			continue;
+		n = read(s->fd, s->buf + s->len, sizeof(s->buf) - s->len);
+		if (n <= 0) {
+			ipc_close_session(s);
+			continue;
+		}
+		s->len += n;
+		ipc_drain_session(s);
+	}
+}
+
+/**
+ * @brief Close every session and delete the UNIX socket file.
  */
 void ipc_cleanup(void)
 {
 	char *sp = getenv(ENV_SOCK_VAR);
+	unsigned int i;
+
+	for (i = 0; i < IPC_MAX_SESSIONS; i++)
+		if (sessions[i].fd != -1)
+			ipc_close_session(&sessions[i]);
 
 	if (sp)
 		unlink(sp);
@@ -107,19 +314,108 @@ void ipc_cleanup(void)
 int ipc_process(char *msg, int len)
 {
 	int err = IPC_ERR_NONE;
-	char **args = ipc_process_args(msg, len, &err);
+	char **args;
+
+	is_query = len > 0 && *msg == MSG_QUERY;
+	args = ipc_process_args(msg, len, &err);
+	if (!args)
+		return err;
 
-	if (**args == MSG_FUNCTION)
+	trace_str(TR_IPC, args[1], **args);
+	if (**args == MSG_FUNCTION && args[1]) {
+		stats_begin(args[1]);
 		err = ipc_process_function(args + 1);
-	else if (**args == MSG_CONFIG)
+	} else if (**args == MSG_CONFIG) {
+		stats_begin("config");
 		err = ipc_process_config(args + 1);
-	else
+	} else if (**args == MSG_QUERY && args[1]) {
+		stats_begin("query");
+		err = ipc_process_query(args + 1);
+	} else {
 		err = IPC_ERR_UNKNOWN_TYPE;
+	}
+	stats_end();
 
 	free(args);
 	return err;
 }
 
+/**
+ * @brief Call a function, as if it had been sent over IPC.
+ *
+ * @param args The name of the function followed by its args, terminated by
+ * NULL.
+ *
+ * @return The error code.
+ */
+int ipc_run_function(char **args)
+{
+	return ipc_process_function(args);
+}
+
+/**
+ * @brief Send the response to a message.
+ *
+ * The response is the error code returned by ipc_process(). If the message
+ * was a query, this is followed by the length of the query's text (as a
+ * uint32_t) and then the text itself. The length is sent even if the query
+ * failed, in which case it is usually zero.
+ *
+ * @param fd The socket that the message was read from, or -1 to discard the
+ * response.
+ * @param err The error code returned by ipc_process().
+ */
+void ipc_respond(int fd, int err)
+{
+	uint32_t len = reply_len;
+
+	if (fd != -1 && write(fd, &err, sizeof(int)) == -1)
+		log_err("Unable to send response. errno: %d", errno);
+	else if (fd != -1 && is_query && (write(fd, &len, sizeof(len)) == -1
+			|| (len && write(fd, reply, reply_len) == -1)))
+		log_err("Unable to send query reply. errno: %d", errno);
+
+	free(reply);
+	reply = NULL;
+	reply_len = 0;
+	is_query = false;
+}
+
+/**
+ * @brief Answer a query, storing the answer so that it can be sent by
+ * ipc_respond().
+ *
+ * @param args The args (as strings).
+ *
+ * @return The error code.
+ */
+static int ipc_process_query(char **args)
+{
+	int err = IPC_ERR_NONE;
+	FILE *f = open_memstream(&reply, &reply_len);
+
+	if (!f)
+		return IPC_ERR_ALLOC;
+
+	if (strcmp(args[0], "stats") == 0)
+		stats_print(f);
+	else if (strcmp(args[0], "latency") == 0)
+		stats_print_latency(f);
+	else if (strcmp(args[0], "trace") == 0)
+		trace_dump(f);
+	else if (strcmp(args[0], "bindings") == 0)
+		keys_print(f);
+	else if (strcmp(args[0], "log_levels") == 0)
+		log_print_levels(f);
+	else if (strcmp(args[0], "children") == 0)
+		process_print(f);
+	else
+		err = IPC_ERR_NO_FUNC;
+
+	fclose(f);
+	return err;
+}
+
 /**
  * @brief Receive a char array from a UNIX socket and subsequently call a
  * function, passing the args from within msg.
@@ -156,7 +452,7 @@ static int ipc_process_function(char **args)
 	} else if (strncmp(args[0], "resize_master", strlen("resize_master")) == 0) {
 		CALL_INT(resize_master, args[1], -100, 100);
 	} else if (strncmp(args[0], "count", strlen("count")) == 0) {
-		CALL_INT(count, args[1], 1, 9);
+		CALL_INT(count, args[1], 1, INT_MAX);
 #undef CALL_INT
 
 /*TODO: Don't do this - we should have a neat wrapper function
@@ -197,12 +493,16 @@ static int ipc_process_function(char **args)
 		toggle_float();
 	} else if (strncmp(args[0], "toggle_fullscreen", strlen("toggle_fullscreen")) == 0) {
 		toggle_fullscreen();
+	} else if (strncmp(args[0], "toggle_sticky", strlen("toggle_sticky")) == 0) {
+		toggle_sticky();
 	} else if (strncmp(args[0], "focus_urgent", strlen("focus_urgent")) == 0) {
 		focus_urgent();
 	} else if (strncmp(args[0], "send_to_scratchpad", strlen("send_to_scratchpad")) == 0) {
-		send_to_scratchpad();
+		send_to_scratchpad(args[1]);
 	} else if (strncmp(args[0], "get_from_scratchpad", strlen("get_from_scratchpad")) == 0) {
-		get_from_scratchpad();
+		get_from_scratchpad(args[1]);
+	} else if (strncmp(args[0], "toggle_scratchpad", strlen("toggle_scratchpad")) == 0) {
+		toggle_scratchpad(args[1]);
 	} else if (strncmp(args[0], "make_master", strlen("make_master")) == 0) {
 		make_master();
 	} else if (strncmp(args[0], "toggle_bar", strlen("toggle_bar")) == 0) {
@@ -215,10 +515,12 @@ static int ipc_process_function(char **args)
 		focus_last_ws();
 	} else if (strncmp(args[0], "paste", strlen("paste")) == 0) {
 		paste();
+	} else if (strncmp(args[0], "stats_reset", strlen("stats_reset")) == 0) {
+		stats_reset();
 	} else if (strncmp(args[0], "change_layout", strlen("change_layout")) == 0) {
 		/* TODO: Allow the layout of an arbitrary monitor to be changed
 		 * without having to focus it. */
-		i = ipc_arg_to_int(args[0], &err, ZOOM, END_LAYOUT - 1);
+		i = ipc_arg_to_int(args[1], &err, ZOOM, END_LAYOUT - 1);
 		if (err == IPC_ERR_NONE)
 			change_layout(mon, i);
 	} else if (strncmp(args[0], "next_layout", strlen("next_layout")) == 0) {
@@ -229,6 +531,12 @@ static int ipc_process_function(char **args)
 		last_layout(mon);
 	} else if (strncmp(args[0], "spawn", strlen("spawn")) == 0) {
 		spawn(args + 1);
+	} else if (strncmp(args[0], "bind", strlen("bind")) == 0) {
+		err = bind_key(args + 1);
+	} else if (strncmp(args[0], "unbind", strlen("unbind")) == 0) {
+		err = unbind_key(args + 1);
+	} else if (strncmp(args[0], "set_mode", strlen("set_mode")) == 0) {
+		err = set_mode(args[1]);
 	} else if (strncmp(args[0], "motion", strlen("motion")) == 0) {
 		motion(args[1]);
 	} else if (strncmp(args[0], "op_kill", strlen("op_kill")) == 0) {
@@ -404,6 +712,30 @@ static int ipc_process_config(char **args)
 		SET_INT(conf.op_gap_size, args[1], 0, 32);
 	else if (strcmp("bar_height", args[0]) == 0)
 		SET_INT(conf.bar_height, args[1], 0, mon->rect.height);
+	else if (strcmp("tab_height", args[0]) == 0)
+		SET_INT(conf.tab_height, args[1], 0, mon->rect.height);
+	else if (strcmp("delete_register_size", args[0]) == 0) {
+		SET_INT(conf.delete_register_size, args[1], 1, DEL_REG_MAX_SIZE);
+		stack_resize(&del_reg, conf.delete_register_size);
+	} else if (strcmp("slow_event_us", args[0]) == 0)
+		SET_INT(conf.slow_event_us, args[1], 0, 10000000);
+	else if (strcmp("drag_rate", args[0]) == 0)
+		SET_INT(conf.drag_rate, args[1], 0, 1000);
+	else if (strcmp("drag_mod", args[0]) == 0) {
+		if (!keys_parse_mods(args[1], &conf.drag_mods))
+			err = IPC_ERR_SYNTAX;
+		drag_grab();
+	}
+	else if (strcmp("log_level", args[0]) == 0) {
+		i = ipc_arg_to_int(args[1], &err, LOG_DEBUG, LOG_NONE);
+		if (err == IPC_ERR_NONE)
+			log_set_level(NULL, i);
+	} else if (strncmp("log_level_", args[0], strlen("log_level_")) == 0) {
+		i = ipc_arg_to_int(args[1], &err, LOG_DEBUG, LOG_NONE);
+		if (err == IPC_ERR_NONE
+				&& !log_set_level(args[0] + strlen("log_level_"), i))
+			err = IPC_ERR_NO_CONFIG;
+	}
 #undef SET_INT
 #define SET_BOOL(opt, arg) \
 	do { \
@@ -412,10 +744,13 @@ static int ipc_process_config(char **args)
 				opt = b; \
 	} while (0)
 
-	else if (strcmp("focus_mouse", args[0]) == 0)
+	else if (strcmp("focus_mouse", args[0]) == 0) {
 		SET_BOOL(conf.focus_mouse, args[1]);
-	else if (strcmp("focus_mouse_click", args[0]) == 0)
+		select_events();
+	} else if (strcmp("focus_mouse_click", args[0]) == 0) {
 		SET_BOOL(conf.focus_mouse_click, args[1]);
+		select_events();
+	}
 	else if (strcmp("follow_move", args[0]) == 0)
 		SET_BOOL(conf.follow_move, args[1]);
 	else if (strcmp("zoom_gap", args[0]) == 0)
@@ -1,6 +1,8 @@
 #ifndef IPC_H
 #define IPC_H
 
+#include <sys/select.h>
+
 /**
  * @file ipc.h
  *
@@ -11,14 +13,26 @@
  * @brief howm
  */
 
+/** The most clients that can hold a session open at once. */
+#define IPC_MAX_SESSIONS 16
+
+/** The type of a message, which is its first byte. A message of type
+ * MSG_SESSION keeps the connection open, every message after it is preceded
+ * by its length as a uint32_t. */
+enum msg_type { MSG_FUNCTION = 1, MSG_CONFIG, MSG_QUERY, MSG_SESSION };
 enum ipc_errs { IPC_ERR_NONE, IPC_ERR_SYNTAX, IPC_ERR_ALLOC, IPC_ERR_NO_FUNC,
 	IPC_ERR_TOO_MANY_ARGS, IPC_ERR_TOO_FEW_ARGS, IPC_ERR_ARG_NOT_INT,
 	IPC_ERR_ARG_NOT_BOOL, IPC_ERR_ARG_TOO_LARGE, IPC_ERR_ARG_TOO_SMALL,
-	IPC_ERR_UNKNOWN_TYPE, IPC_ERR_NO_CONFIG };
+	IPC_ERR_UNKNOWN_TYPE, IPC_ERR_NO_CONFIG, IPC_ERR_BUSY };
 enum arg_types { TYPE_IGNORE, TYPE_INT, TYPE_STR };
 
 void ipc_cleanup(void);
 int ipc_init(void);
+void ipc_accept(int sock_fd);
+int ipc_set_fds(fd_set *fds, int nfds);
+void ipc_read_sessions(fd_set *fds);
 int ipc_process(char *msg, int len);
+int ipc_run_function(char **args);
+void ipc_respond(int fd, int err);
 
 #endif
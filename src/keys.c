@@ -0,0 +1,491 @@
+#define _POSIX_C_SOURCE 200809L
+#define LOG_SUBSYS LOG_HANDLER
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#include "backend.h"
+#include "helper.h"
+#include "howm.h"
+#include "ipc.h"
+#include "keys.h"
+#include "trace.h"
+
+/**
+ * @file keys.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Key bindings that howm grabs itself, so that a keypress calls a
+ * function directly rather than going through sxhkd, cottage and the socket.
+ *
+ * Each binding belongs to a mode and maps a chord, such as super+shift+k, to
+ * a function and its args, exactly as they would be sent by cottage -f. Only
+ * the bindings of the current mode are grabbed.
+ */
+
+/** Caps Lock and Num Lock, which shouldn't stop a binding from matching. Num
+ * Lock is assumed to be Mod2, as it is on almost every keyboard. */
+#define IGNORED_MODS (XCB_MOD_MASK_LOCK | XCB_MOD_MASK_2)
+/** The modifier bits of a key event's state, without the buttons. */
+#define KEY_MODS 0xff
+
+/**
+ * @brief A chord and the function that it calls.
+ */
+struct binding {
+	char mode[KEYS_MODE_LEN]; /**< The mode that the binding is active in. */
+	uint16_t mods; /**< The modifiers that must be held. */
+	xcb_keysym_t sym; /**< The key that must be pressed. */
+	char **cmd; /**< The function and its args, terminated by NULL. The
+		      strings are stored in the same allocation. */
+};
+
+static const struct {
+	const char *name;
+	uint16_t mask;
+} mod_names[] = {
+	{ "shift", XCB_MOD_MASK_SHIFT },
+	{ "ctrl", XCB_MOD_MASK_CONTROL },
+	{ "control", XCB_MOD_MASK_CONTROL },
+	{ "alt", XCB_MOD_MASK_1 },
+	{ "mod1", XCB_MOD_MASK_1 },
+	{ "mod2", XCB_MOD_MASK_2 },
+	{ "mod3", XCB_MOD_MASK_3 },
+	{ "super", XCB_MOD_MASK_4 },
+	{ "mod4", XCB_MOD_MASK_4 },
+	{ "mod5", XCB_MOD_MASK_5 },
+};
+
+/* The values are from X11/keysymdef.h. Keys that type a single printable
+ * character can also be given as that character. */
+static const struct {
+	const char *name;
+	xcb_keysym_t sym;
+} key_names[] = {
+	{ "space", 0x0020 },
+	{ "apostrophe", 0x0027 },
+	{ "plus", 0x002b },
+	{ "comma", 0x002c },
+	{ "minus", 0x002d },
+	{ "period", 0x002e },
+	{ "slash", 0x002f },
+	{ "semicolon", 0x003b },
+	{ "equal", 0x003d },
+	{ "bracketleft", 0x005b },
+	{ "backslash", 0x005c },
+	{ "bracketright", 0x005d },
+	{ "grave", 0x0060 },
+	{ "BackSpace", 0xff08 },
+	{ "Tab", 0xff09 },
+	{ "Return", 0xff0d },
+	{ "Pause", 0xff13 },
+	{ "Escape", 0xff1b },
+	{ "Home", 0xff50 },
+	{ "Left", 0xff51 },
+	{ "Up", 0xff52 },
+	{ "Right", 0xff53 },
+	{ "Down", 0xff54 },
+	{ "Prior", 0xff55 },
+	{ "Next", 0xff56 },
+	{ "End", 0xff57 },
+	{ "Print", 0xff61 },
+	{ "Insert", 0xff63 },
+	{ "Menu", 0xff67 },
+	{ "Delete", 0xffff },
+};
+
+/** The keysym of F1, F2 to F35 follow it. */
+#define KEYSYM_F1 0xffbe
+#define MAX_F_KEY 35
+
+static struct binding *bindings;
+static unsigned int nr_bindings;
+static char cur_mode[KEYS_MODE_LEN] = KEYS_DEF_MODE;
+
+/**
+ * @brief Convert the name of a key into a keysym.
+ *
+ * @param name The name of the key, such as Return, F1 or k.
+ * @param len The length of name.
+ *
+ * @return The keysym, or XCB_NO_SYMBOL if the name isn't known.
+ */
+static xcb_keysym_t name_to_keysym(const char *name, size_t len)
+{
+	unsigned int i;
+	int f;
+
+	if (len == 1 && isgraph((unsigned char)*name))
+		return tolower((unsigned char)*name);
+	if (len > 1 && len <= 3 && name[0] == 'F') {
+		f = atoi(name + 1);
+		if (f >= 1 && f <= MAX_F_KEY)
+			return KEYSYM_F1 + f - 1;
+	}
+	for (i = 0; i < LENGTH(key_names); i++)
+		if (strlen(key_names[i].name) == len
+				&& strncmp(key_names[i].name, name, len) == 0)
+			return key_names[i].sym;
+	return XCB_NO_SYMBOL;
+}
+
+/**
+ * @brief Convert the name of a modifier into its mask.
+ *
+ * @param name The name of the modifier, such as super.
+ * @param len The length of name.
+ * @param mask Where the mask is stored.
+ *
+ * @return True if the name is known.
+ */
+static bool name_to_mod(const char *name, size_t len, uint16_t *mask)
+{
+	unsigned int i;
+
+	for (i = 0; i < LENGTH(mod_names); i++) {
+		if (strlen(mod_names[i].name) == len
+				&& strncmp(mod_names[i].name, name, len) == 0) {
+			*mask = mod_names[i].mask;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Split a chord into its modifiers and key.
+ *
+ * @param chord The chord, modifiers and a key separated by +, such as
+ * super+shift+Return.
+ * @param mods Where the modifiers are stored.
+ * @param sym Where the key is stored.
+ *
+ * @return True if the chord is valid.
+ */
+static bool parse_chord(const char *chord, uint16_t *mods, xcb_keysym_t *sym)
+{
+	size_t len;
+	uint16_t mask;
+
+	*mods = 0;
+	for (;;) {
+		len = strcspn(chord, "+");
+		if (chord[len] == '\0')
+			break;
+		if (!name_to_mod(chord, len, &mask))
+			return false;
+		*mods |= mask;
+		chord += len + 1;
+	}
+	*sym = name_to_keysym(chord, len);
+	return *sym != XCB_NO_SYMBOL;
+}
+
+/**
+ * @brief Parse a set of modifiers, such as super or ctrl+alt.
+ *
+ * @param s The modifiers separated by +, or "none" for no modifiers.
+ * @param mods Where the modifiers are stored.
+ *
+ * @return True if every modifier is known.
+ */
+bool keys_parse_mods(const char *s, uint16_t *mods)
+{
+	size_t len;
+	uint16_t mask;
+
+	*mods = 0;
+	if (strcmp(s, "none") == 0)
+		return true;
+	for (;;) {
+		len = strcspn(s, "+");
+		if (!name_to_mod(s, len, &mask))
+			return false;
+		*mods |= mask;
+		if (s[len] == '\0')
+			return true;
+		s += len + 1;
+	}
+}
+
+/**
+ * @brief Copy a NULL terminated array of strings into a single allocation.
+ *
+ * @param args The strings to be copied.
+ *
+ * @return The copy, which can be freed with a single call to free().
+ */
+static char **copy_args(char **args)
+{
+	unsigned int n, i;
+	size_t len = 0;
+	char **copy, *p;
+
+	for (n = 0; args[n]; n++)
+		len += strlen(args[n]) + 1;
+	copy = malloc((n + 1) * sizeof(char *) + len);
+	if (!copy) {
+		log_err("Can't allocate memory for a key binding");
+		exit(EXIT_FAILURE);
+	}
+	p = (char *)(copy + n + 1);
+	for (i = 0; i < n; i++) {
+		copy[i] = p;
+		p = stpcpy(p, args[i]) + 1;
+	}
+	copy[n] = NULL;
+	return copy;
+}
+
+/**
+ * @brief Grab every key that produces a binding's keysym.
+ *
+ * Each key is grabbed with and without Caps Lock and Num Lock, so that the
+ * binding still works when they are on.
+ *
+ * @param b The binding.
+ */
+static void grab_binding(const struct binding *b)
+{
+	static const uint16_t ignored[] = { 0, XCB_MOD_MASK_LOCK,
+		XCB_MOD_MASK_2, XCB_MOD_MASK_LOCK | XCB_MOD_MASK_2 };
+	xcb_keycode_t *codes, *code;
+	unsigned int i;
+
+	codes = xb->keysym_to_keycodes(b->sym);
+	if (!codes) {
+		log_warn("No key produces keysym <0x%x>", b->sym);
+		return;
+	}
+	for (code = codes; *code != XCB_NO_SYMBOL; code++)
+		for (i = 0; i < LENGTH(ignored); i++)
+			xb->grab_key(screen->root, b->mods | ignored[i], *code);
+	free(codes);
+}
+
+/**
+ * @brief Find a binding.
+ *
+ * @param mode The mode that the binding is in.
+ * @param mods The binding's modifiers.
+ * @param sym The binding's key.
+ *
+ * @return The binding, or NULL if there isn't one.
+ */
+static struct binding *find_binding(const char *mode, uint16_t mods,
+		xcb_keysym_t sym)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_bindings; i++)
+		if (bindings[i].sym == sym && bindings[i].mods == mods
+				&& strncmp(bindings[i].mode, mode, KEYS_MODE_LEN - 1) == 0)
+			return &bindings[i];
+	return NULL;
+}
+
+/**
+ * @brief Bind a chord to a function, replacing any binding that the chord
+ * already has in that mode.
+ *
+ * @param args The mode, the chord and then the function and its args, as
+ * they would be passed to cottage -f.
+ *
+ * @return An IPC error code.
+ *
+ * @ingroup commands
+ */
+int bind_key(char **args)
+{
+	struct binding *b;
+	uint16_t mods;
+	xcb_keysym_t sym;
+
+	if (!args[0] || !args[1] || !args[2])
+		return IPC_ERR_TOO_FEW_ARGS;
+	if (strlen(args[0]) >= KEYS_MODE_LEN)
+		return IPC_ERR_ARG_TOO_LARGE;
+	if (!parse_chord(args[1], &mods, &sym)) {
+		log_warn("Can't bind unknown chord <%s>", args[1]);
+		return IPC_ERR_SYNTAX;
+	}
+
+	b = find_binding(args[0], mods, sym);
+	if (b) {
+		/* The key is already grabbed, only the function changes. */
+		free(b->cmd);
+	} else {
+		b = realloc(bindings, (nr_bindings + 1) * sizeof(*bindings));
+		if (!b) {
+			log_err("Can't allocate memory for a key binding");
+			exit(EXIT_FAILURE);
+		}
+		bindings = b;
+		b = &bindings[nr_bindings++];
+		snprintf(b->mode, sizeof(b->mode), "%s", args[0]);
+		b->mods = mods;
+		b->sym = sym;
+		if (strcmp(b->mode, cur_mode) == 0)
+			grab_binding(b);
+	}
+	b->cmd = copy_args(args + 2);
+	log_info("Bound <%s> in mode <%s> to <%s>", args[1], args[0], args[2]);
+	return IPC_ERR_NONE;
+}
+
+/**
+ * @brief Remove a binding.
+ *
+ * @param args The mode and the chord of the binding.
+ *
+ * @return An IPC error code.
+ *
+ * @ingroup commands
+ */
+int unbind_key(char **args)
+{
+	struct binding *b;
+	uint16_t mods;
+	xcb_keysym_t sym;
+
+	if (!args[0] || !args[1])
+		return IPC_ERR_TOO_FEW_ARGS;
+	if (!parse_chord(args[1], &mods, &sym))
+		return IPC_ERR_SYNTAX;
+	b = find_binding(args[0], mods, sym);
+	if (!b)
+		return IPC_ERR_NONE;
+
+	free(b->cmd);
+	*b = bindings[--nr_bindings];
+	log_info("Unbound <%s> in mode <%s>", args[1], args[0]);
+	if (strcmp(args[0], cur_mode) == 0)
+		grab_keys();
+	return IPC_ERR_NONE;
+}
+
+/**
+ * @brief Change the mode, so that only its bindings are grabbed.
+ *
+ * @param mode The name of the mode.
+ *
+ * @return An IPC error code.
+ *
+ * @ingroup commands
+ */
+int set_mode(char *mode)
+{
+	if (!mode)
+		return IPC_ERR_TOO_FEW_ARGS;
+	if (strlen(mode) >= KEYS_MODE_LEN)
+		return IPC_ERR_ARG_TOO_LARGE;
+	snprintf(cur_mode, sizeof(cur_mode), "%s", mode);
+	log_info("Changed to mode <%s>", cur_mode);
+	grab_keys();
+	return IPC_ERR_NONE;
+}
+
+/**
+ * @brief Grab the keys of every binding in the current mode, releasing any
+ * that were grabbed before.
+ */
+void grab_keys(void)
+{
+	unsigned int i;
+
+	xb->ungrab_keys(screen->root);
+	for (i = 0; i < nr_bindings; i++)
+		if (strcmp(bindings[i].mode, cur_mode) == 0)
+			grab_binding(&bindings[i]);
+}
+
+/**
+ * @brief Call the function that a key press is bound to.
+ *
+ * @param ev The key press event.
+ */
+void key_press(xcb_key_press_event_t *ev)
+{
+	xcb_keysym_t sym = xb->keycode_to_keysym(ev->detail);
+	uint16_t mods = ev->state & KEY_MODS & ~IGNORED_MODS;
+	struct binding *b = find_binding(cur_mode, mods, sym);
+	char **cmd;
+	int err;
+
+	if (!b)
+		return;
+
+	/* The function may change the bindings, so run a copy of it. */
+	cmd = copy_args(b->cmd);
+	trace_str(TR_KEY, cmd[0], sym);
+	err = ipc_run_function(cmd);
+	if (err != IPC_ERR_NONE)
+		log_warn("Binding for <%s> failed with error %d", cmd[0], err);
+	free(cmd);
+}
+
+/**
+ * @brief Print a line for each binding, in the form:
+ *
+ *	mode chord function args...
+ *
+ * @param f Where the bindings should be printed.
+ */
+void keys_print(FILE *f)
+{
+	unsigned int i, j;
+	xcb_keysym_t sym;
+	char **arg;
+
+	for (i = 0; i < nr_bindings; i++) {
+		fprintf(f, "%s ", bindings[i].mode);
+		for (j = 0; j < LENGTH(mod_names); j++)
+			/* Skip the aliases, which share a mask with the name
+			 * before them. */
+			if (bindings[i].mods & mod_names[j].mask
+					&& (j == 0 || mod_names[j - 1].mask
+						!= mod_names[j].mask))
+				fprintf(f, "%s+", mod_names[j].name);
+
+		sym = bindings[i].sym;
+		for (j = 0; j < LENGTH(key_names); j++)
+			if (key_names[j].sym == sym)
+				break;
+		if (j < LENGTH(key_names))
+			fprintf(f, "%s", key_names[j].name);
+		else if (sym >= KEYSYM_F1 && sym < KEYSYM_F1 + MAX_F_KEY)
+			fprintf(f, "F%u", sym - KEYSYM_F1 + 1);
+		else if (sym < 0x80 && isgraph(sym))
+			fputc(sym, f);
+		else
+			fprintf(f, "0x%x", sym);
+
+		for (arg = bindings[i].cmd; *arg; arg++)
+			fprintf(f, " %s", *arg);
+		fputc('\n', f);
+	}
+}
+
+/**
+ * @brief Release the grabbed keys and forget every binding.
+ */
+void keys_cleanup(void)
+{
+	unsigned int i;
+
+	if (nr_bindings > 0)
+		xb->ungrab_keys(screen->root);
+	for (i = 0; i < nr_bindings; i++)
+		free(bindings[i].cmd);
+	free(bindings);
+	bindings = NULL;
+	nr_bindings = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef KEYS_H
+#define KEYS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <xcb/xcb.h>
+
+/**
+ * @file keys.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The mode that howm starts in. */
+#define KEYS_DEF_MODE "normal"
+/** The maximum length of a mode's name, including the terminator. */
+#define KEYS_MODE_LEN 32
+
+int bind_key(char **args);
+int unbind_key(char **args);
+int set_mode(char *mode);
+bool keys_parse_mods(const char *s, uint16_t *mods);
+void grab_keys(void);
+void key_press(xcb_key_press_event_t *ev);
+void keys_print(FILE *f);
+void keys_cleanup(void);
+
+#endif
@@ -1,10 +1,18 @@
+#define LOG_SUBSYS LOG_LAYOUT
+
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+#include "backend.h"
 #include "client.h"
+#include "configure.h"
 #include "helper.h"
 #include "howm.h"
 #include "layout.h"
+#include "monitor.h"
+#include "tabs.h"
+#include "trace.h"
 #include "types.h"
 #include "xcb_help.h"
 
@@ -22,12 +30,14 @@
 static void stack(monitor_t *m);
 static void grid(monitor_t *m);
 static void zoom(monitor_t *m);
+static void tabbed(monitor_t *m);
 
 static void(*layout_handler[]) (monitor_t *m) = {
 	[GRID] = grid,
 	[ZOOM] = zoom,
 	[HSTACK] = stack,
-	[VSTACK] = stack
+	[VSTACK] = stack,
+	[TABBED] = tabbed
 };
 
 /**
@@ -37,10 +47,25 @@ static void(*layout_handler[]) (monitor_t *m) = {
  */
 void arrange_windows(monitor_t *m)
 {
-	if (!m->ws->head)
+	client_t *fs;
+	int layout;
+
+	if (!m->ws->head) {
+		tabs_hide(m);
 		return;
-	log_debug("Arranging windows");
-	layout_handler[m->ws->head->next ? m->ws->layout : ZOOM](mon);
+	}
+	TRACE(TR_ARRANGE, monitor_to_index(m), m->ws->layout, m->ws->client_cnt);
+	layout = m->ws->head->next ? m->ws->layout : ZOOM;
+	/* The layout can wait until the fullscreen client stops hiding it. */
+	fs = fullscreen_client(m->ws);
+	if (fs) {
+		draw_clients();
+		tabs_unhide(fs);
+	} else {
+		layout_handler[layout](mon);
+		if (layout != TABBED)
+			tabs_restore(m);
+	}
 	howm_info();
 }
 
@@ -63,8 +88,6 @@ static void grid(monitor_t *m)
 		return;
 	}
 
-	log_info("Arranging %d clients in grid layout", n);
-
 	for (cols = 1; cols <= n / 2; cols++)
 		if (cols * cols >= n)
 			break;
@@ -102,7 +125,6 @@ static void zoom(monitor_t *m)
 {
 	client_t *c;
 
-	log_info("Arranging clients in zoom format");
 	/* When zoom is called because there aren't enough clients for other
 	 * layouts to work, draw a border to be consistent with other layouts.
 	 * */
@@ -117,6 +139,50 @@ static void zoom(monitor_t *m)
 	draw_clients();
 }
 
+/**
+ * @brief Show one tiled client at a time below a strip of tabs, one for each
+ * tiled client.
+ *
+ * Only the active tab's client is mapped, the others are unmapped until they
+ * are selected.
+ *
+ * @param m The monitor to be arranged.
+ */
+static void tabbed(monitor_t *m)
+{
+	client_t *c, *active = tab_active(m->ws);
+	xcb_rectangle_t r = tabs_rect(m);
+	uint16_t client_y = conf.bar_bottom ? m->rect.y : m->rect.y + m->ws->bar_height;
+	bool was_hidden;
+
+	if (!active) {
+		zoom(mon);
+		return;
+	}
+
+	change_client_geom(active, m->rect.x, client_y + r.height,
+			m->rect.width, m->rect.height - m->ws->bar_height - r.height);
+	for (c = m->ws->head; c; c = c->next) {
+		if (FFT(c) || c == active || c->is_tab_hidden)
+			continue;
+		xb->unmap_window(c->win);
+		c->is_tab_hidden = true;
+	}
+	was_hidden = active->is_tab_hidden;
+	active->is_tab_hidden = false;
+	draw_clients();
+	/* Map the active tab, and any hidden client that has since stopped
+	 * being tiled, after their new geometry has been sent. */
+	for (c = m->ws->head; c; c = c->next)
+		if (FFT(c))
+			tabs_unhide(c);
+	if (was_hidden) {
+		configure_commit();
+		xb->map_window(active->win);
+	}
+	tabs_draw(m);
+}
+
 /**
  * @brief Arrange the windows in a stack, whether that be horizontal or
  * vertical is decided by the current_layout.
@@ -163,7 +229,6 @@ static void stack(monitor_t *m)
 	/* TODO: Need to take into account when this has remainders. */
 	client_span = (span / (n - 1));
 
-	log_info("Arranging %d clients in %sstack layout", n, vert ? "v" : "h");
 	if (vert) {
 		change_client_geom(c, m->rect.x, client_y,
 			    ms, span);
@@ -198,9 +263,19 @@ static void stack(monitor_t *m)
  */
 void change_layout(monitor_t *m, const int layout)
 {
+	client_t *c;
+	bool changes_tabs;
+
 	if (layout == m->ws->layout || layout >= END_LAYOUT || layout < ZOOM)
 		return;
+	if (layout == TABBED)
+		for (c = m->ws->head; c; c = c->next)
+			c->has_title = false;
+	changes_tabs = layout == TABBED || m->ws->layout == TABBED;
 	m->ws->layout = layout;
+	/* Titles are only watched while a workspace is tabbed. */
+	if (changes_tabs)
+		select_events();
 	update_focused_client(m->ws->c);
 	log_info("Changed layout from %d to %d", m->ws->last_layout,  m->ws->layout);
 	m->ws->last_layout = m->ws->layout;
@@ -13,7 +13,7 @@
  * @brief howm
  */
 
-enum layouts { ZOOM, GRID, HSTACK, VSTACK, END_LAYOUT };
+enum layouts { ZOOM, GRID, HSTACK, VSTACK, TABBED, END_LAYOUT };
 
 void arrange_windows(monitor_t *m);
 void change_layout(monitor_t *m, const int layout);
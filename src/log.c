@@ -0,0 +1,72 @@
+#define LOG_SUBSYS LOG_CORE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "helper.h"
+#include "log.h"
+
+/**
+ * @file log.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief The log level of each of howm's subsystems.
+ */
+
+/** The least severe level that is logged, for each subsystem. */
+int log_levels[LOG_NR_SUBSYS] = {
+	[LOG_CORE] = LOG_LEVEL,
+	[LOG_IPC] = LOG_LEVEL,
+	[LOG_LAYOUT] = LOG_LEVEL,
+	[LOG_CLIENT] = LOG_LEVEL,
+	[LOG_HANDLER] = LOG_LEVEL,
+	[LOG_MONITOR] = LOG_LEVEL,
+};
+
+static const char *log_subsys_names[LOG_NR_SUBSYS] = {
+	[LOG_CORE] = "core",
+	[LOG_IPC] = "ipc",
+	[LOG_LAYOUT] = "layout",
+	[LOG_CLIENT] = "client",
+	[LOG_HANDLER] = "handler",
+	[LOG_MONITOR] = "monitor",
+};
+
+/**
+ * @brief Change how much a subsystem logs.
+ *
+ * @param subsys The name of the subsystem, or NULL for all of them.
+ * @param level The least severe level to log, between LOG_DEBUG and LOG_NONE.
+ *
+ * @return False if there is no subsystem with that name.
+ */
+bool log_set_level(const char *subsys, int level)
+{
+	unsigned int i;
+	bool found = false;
+
+	for (i = 0; i < LOG_NR_SUBSYS; i++) {
+		if (!subsys || strcmp(subsys, log_subsys_names[i]) == 0) {
+			log_levels[i] = level;
+			found = true;
+		}
+	}
+	return found;
+}
+
+/**
+ * @brief Print the log level of each subsystem, one per line.
+ *
+ * @param f Where the levels should be printed.
+ */
+void log_print_levels(FILE *f)
+{
+	unsigned int i;
+
+	for (i = 0; i < LOG_NR_SUBSYS; i++)
+		fprintf(f, "%s %d\n", log_subsys_names[i], log_levels[i]);
+}
@@ -0,0 +1,62 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * @file log.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** How much detail should be logged by default, this can be changed at
+ * runtime for each subsystem. A LOG_LEVEL of INFO will log almost everything,
+ * LOG_WARN will log warnings and errors and LOG_ERR will log only errors.
+ *
+ * LOG_NONE means nothing will be logged.
+ *
+ * LOG_DEBUG should be used by developers.
+ */
+#define LOG_LEVEL LOG_WARN
+
+#define LOG_DEBUG 1
+#define LOG_INFO 2
+#define LOG_WARN 3
+#define LOG_ERR 4
+#define LOG_NONE 5
+
+/** The parts of howm that have their own log level. Each source file defines
+ * LOG_SUBSYS as one of these before including any headers. */
+enum log_subsys { LOG_CORE, LOG_IPC, LOG_LAYOUT, LOG_CLIENT, LOG_HANDLER,
+	LOG_MONITOR, LOG_NR_SUBSYS };
+
+extern int log_levels[LOG_NR_SUBSYS];
+
+bool log_set_level(const char *subsys, int level);
+void log_print_levels(FILE *f);
+
+/* Add comments so that splint ignores this as it doesn't support variadic
+ * macros.
+ */
+/*@ignore@*/
+
+/* When a level is disabled, only the comparison is paid for. The arguments
+ * aren't evaluated. */
+#define log_at(lvl, tag, M, ...) \
+	do { \
+		if (log_levels[LOG_SUBSYS] <= lvl) \
+			fprintf(stderr, "[" tag "] (%s:%d) " M "\n", __FILE__, __LINE__, ##__VA_ARGS__); \
+	} while (0)
+
+#define log_debug(M, ...) log_at(LOG_DEBUG, "DEBUG", M, ##__VA_ARGS__)
+#define log_info(M, ...) log_at(LOG_INFO, "INFO", M, ##__VA_ARGS__)
+#define log_warn(M, ...) log_at(LOG_WARN, "WARN", M, ##__VA_ARGS__)
+#define log_err(M, ...) log_at(LOG_ERR, "ERROR", M, ##__VA_ARGS__)
+/*@end@*/
+
+#endif
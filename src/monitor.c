@@ -1,9 +1,15 @@
+#define LOG_SUBSYS LOG_MONITOR
+
 #include <stdlib.h>
 #include <xcb/randr.h>
 
+#include "backend.h"
 #include "monitor.h"
 #include "helper.h"
 #include "howm.h"
+#include "stats.h"
+#include "sticky.h"
+#include "tabs.h"
 #include "workspace.h"
 #include "xcb_help.h"
 
@@ -65,6 +71,8 @@ void remove_monitor(monitor_t *m)
 
 	mon_cnt--;
 
+	/* Sticky clients go the same way as the workspaces' clients. */
+	sticky_release_all(m);
 	while (m->ws_head)
 		remove_ws(m, m->ws_head);
 
@@ -81,6 +89,7 @@ void remove_monitor(monitor_t *m)
 
 	/* TODO: Maybe we'll need to refocus? */
 
+	tabs_free(m);
 	free(m);
 }
 
@@ -101,8 +110,7 @@ void focus_monitor(monitor_t *m)
 	center_pointer(m->rect);
 
 	if (mon->ws && mon->ws->c)
-		xcb_set_input_focus(dpy, XCB_INPUT_FOCUS_POINTER_ROOT, mon->ws->c->win,
-			    XCB_CURRENT_TIME);
+		xb->set_input_focus(mon->ws->c->win);
 
 	ewmh_set_current_workspace();
 }
@@ -176,10 +184,12 @@ static bool scan_xrandr_monitors(void)
 	xcb_randr_get_output_info_cookie_t cookies[nr_outputs];
 
 	for (i = 0; i < nr_outputs; i++)
-		cookies[i] = xcb_randr_get_output_info(dpy, outputs[i], XCB_CURRENT_TIME);
+		cookies[i] = XREQ(xcb_randr_get_output_info(dpy, outputs[i], XCB_CURRENT_TIME));
 
 	for (i = 0; i < nr_outputs; i++) {
+		stats_wait_begin();
 		oir = xcb_randr_get_output_info_reply(dpy, cookies[i], NULL);
+		stats_wait_end();
 		if (!oir || oir->crtc == XCB_NONE) {
 			free(oir);
 			continue;
@@ -1,14 +1,19 @@
+#define LOG_SUBSYS LOG_CLIENT
+
 #include <string.h>
 #include <xcb/xcb.h>
 #include <xcb/xproto.h>
 
+#include "backend.h"
 #include "client.h"
 #include "helper.h"
 #include "howm.h"
 #include "op.h"
 #include "scratchpad.h"
+#include "sticky.h"
 #include "types.h"
 #include "workspace.h"
+#include "xcb_help.h"
 
 /**
  * @file op.c
@@ -20,13 +25,22 @@
  * @brief All of howm's operators are implemented here.
  */
 
+/** The operator that is waiting for a count and a motion. */
+void (*operator_func)(const unsigned int type, unsigned int cnt);
+
 static int cur_cnt = 1;
 
 static void change_gaps(const unsigned int type, unsigned int cnt, int size);
+static void cut_ws(workspace_t *ws, struct client_run *run);
+static void focus_client_offset(int offset);
+static void focus_ws_offset(unsigned int cnt, bool up);
 
 /**
  * @brief An operator that kills an arbitrary amount of clients or workspaces.
  *
+ * The focused client and those after it (or the current workspace and those
+ * after it) are killed, and the current workspace is refocused just once.
+ *
  * @param type Whether to kill workspaces or clients.
  * @param cnt How many workspaces or clients to kill.
  *
@@ -34,18 +48,19 @@ static void change_gaps(const unsigned int type, unsigned int cnt, int size);
  */
 void op_kill(const unsigned int type, unsigned int cnt)
 {
+	workspace_t *ws;
+
 	if (type == WORKSPACE) {
 		log_info("Killing %d workspaces", cnt);
-		while (cnt > 0) {
-			kill_ws(mon, offset_ws(mon->ws, cnt - 1));
-			cnt--;
-		}
+		for (ws = mon->ws; ws && cnt > 0; ws = ws->next, cnt--)
+			kill_ws(mon, ws);
+	} else if (type == CLIENT && mon->sticky_c) {
+		/* A sticky client isn't part of the workspace, so the count
+		 * can't extend past it. */
+		sticky_kill(mon);
 	} else if (type == CLIENT) {
 		log_info("Killing %d clients", cnt);
-		while (cnt > 0) {
-			kill_client(mon, mon->ws, mon->ws->c);
-			cnt--;
-		}
+		kill_clients(mon, mon->ws, mon->ws->c, cnt);
 	}
 }
 
@@ -91,15 +106,10 @@ void op_move_up(const unsigned int type, unsigned int cnt)
  */
 void op_focus_up(const unsigned int type, unsigned int cnt)
 {
-	while (cnt > 0) {
-		if (type == CLIENT)
-			focus_next_client();
-		else if (type == WORKSPACE)
-			focus_next_ws();
-		else
-			return;
-		cnt--;
-	}
+	if (type == CLIENT)
+		focus_client_offset(cnt);
+	else if (type == WORKSPACE)
+		focus_ws_offset(cnt, true);
 }
 
 /**
@@ -112,15 +122,45 @@ void op_focus_up(const unsigned int type, unsigned int cnt)
  */
 void op_focus_down(const unsigned int type, unsigned int cnt)
 {
-	while (cnt > 0) {
-		if (type == CLIENT)
-			focus_prev_client();
-		else if (type == WORKSPACE)
-			focus_prev_ws();
-		else
-			return;
-		cnt--;
-	}
+	if (type == CLIENT)
+		focus_client_offset(-(int)cnt);
+	else if (type == WORKSPACE)
+		focus_ws_offset(cnt, false);
+}
+
+/**
+ * @brief Focus the client that is a number of places away from the focused
+ * one, wrapping around the ends of the client list. The client that had focus
+ * becomes the previously focused client.
+ *
+ * @param offset How many places to move focus, negative values move towards
+ * the head of the list.
+ */
+static void focus_client_offset(int offset)
+{
+	client_t *c = offset_client(mon->ws, mon->ws->c, offset);
+
+	if (!c || c == mon->ws->c)
+		return;
+	mon->ws->prev_foc = mon->ws->c;
+	update_focused_client(c);
+}
+
+/**
+ * @brief Change to the workspace that is a number of places away from the
+ * current one, stopping at either end of the workspace list.
+ *
+ * @param cnt How many workspaces to move.
+ * @param up True to move towards the end of the list.
+ */
+static void focus_ws_offset(unsigned int cnt, bool up)
+{
+	workspace_t *ws = mon->ws;
+
+	for (; cnt > 0 && (up ? ws->next : ws->prev); cnt--)
+		ws = up ? ws->next : ws->prev;
+	if (ws != mon->ws)
+		change_ws(ws);
 }
 
 /**
@@ -173,14 +213,63 @@ static void change_gaps(const unsigned int type, unsigned int cnt, int size)
 	}
 }
 
+/**
+ * @brief Detach every client of a workspace and append them to a run.
+ *
+ * The client list is taken as a whole, so only the walk to unmap the windows
+ * (which are all sent before the next flush) depends on the amount of
+ * clients.
+ *
+ * @param ws The workspace to be emptied.
+ * @param run The run that the clients are appended to.
+ */
+static void cut_ws(workspace_t *ws, struct client_run *run)
+{
+	client_t *c;
+	bool visible = false;
+	monitor_t *m;
+
+	if (!ws->head)
+		return;
+
+	for (m = mon_head; m && !visible; m = m->next)
+		visible = m->ws == ws;
+
+	for (c = ws->head; ; c = c->next) {
+		if (visible)
+			xb->unmap_window(c->win);
+		if (!c->next)
+			break;
+	}
+
+	if (run->tail)
+		run->tail->next = ws->head;
+	else
+		run->head = ws->head;
+	run->tail = c;
+	run->cnt += ws->client_cnt;
+
+	ws->head = ws->c = ws->prev_foc = NULL;
+	ws->client_cnt = 0;
+
+	if (ws == mon->ws) {
+		focus_root();
+		howm_info();
+	}
+}
+
 /**
  * @brief Cut one or more clients and add them onto howm's delete register
- * stack (if there is space).
+ * stack. If the stack is full, its oldest run is evicted.
  *
  * A segment of howm's internal client list is taken and placed onto the delete
  * register stack. All clients from the list segment must be unmapped and the
  * remaining clients must be refocused.
  *
+ * Cutting workspaces (or at least as many clients as there are on the current
+ * workspace) empties them entirely. All of the clients that are cut by one
+ * use of the operator are stored as a single run.
+ *
  * @param type Whether to cut an entire workspace or client.
  * @param cnt The amount of clients or workspaces to cut.
  *
@@ -191,22 +280,28 @@ void op_cut(const unsigned int type, unsigned int cnt)
 	client_t *tail = mon->ws->c;
 	client_t *head = mon->ws->c;
 	client_t *head_prev = prev_client(mon->ws->c, mon->ws);
+	unsigned int n = cnt;
 	bool wrap = false;
+	struct client_run run = { NULL, NULL, 0 };
+	workspace_t *ws;
 
-	if (!head)
-		return;
-
-	if (del_reg.size >= conf.delete_register_size) {
-		log_warn("No more stack space.");
-		return;
-	}
-
-	if ((type == CLIENT && cnt >= mon->ws->client_cnt) || type == WORKSPACE) {
-		/* TODO: Actually implement this... */
+	/* A workspace cut can start from an empty workspace, cut_ws() skips
+	 * it. */
+	if (type == CLIENT && !head)
 		return;
 
+	if (type == WORKSPACE) {
+		log_info("Cutting %d workspaces", cnt);
+		for (ws = mon->ws; ws && cnt > 0; ws = ws->next, cnt--)
+			cut_ws(ws, &run);
+		stack_push(&del_reg, run);
+	} else if (type == CLIENT && cnt >= mon->ws->client_cnt) {
+		log_info("Cutting all clients on workspace <%d>",
+				workspace_to_index(mon->ws));
+		cut_ws(mon->ws, &run);
+		stack_push(&del_reg, run);
 	} else if (type == CLIENT) {
-		xcb_unmap_window(dpy, head->win);
+		xb->unmap_window(head->win);
 		mon->ws->client_cnt--;
 		while (cnt > 1) {
 			if (!tail->next && next_client(tail)) {
@@ -219,7 +314,7 @@ void op_cut(const unsigned int type, unsigned int cnt)
 			if (tail == mon->ws->prev_foc)
 				mon->ws->prev_foc = NULL;
 			tail = next_client(tail);
-			xcb_unmap_window(dpy, tail->win);
+			xb->unmap_window(tail->win);
 			cnt--;
 			mon->ws->client_cnt--;
 		}
@@ -236,7 +331,7 @@ void op_cut(const unsigned int type, unsigned int cnt)
 		mon->ws->c = head_prev;
 		tail->next = NULL;
 		update_focused_client(head_prev);
-		stack_push(&del_reg, head);
+		stack_push(&del_reg, (struct client_run) { head, tail, n });
 	}
 }
 
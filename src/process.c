@@ -0,0 +1,263 @@
+/* POSIX_SPAWN_SETSID and signalfd() are GNU extensions. */
+#define _GNU_SOURCE
+#define LOG_SUBSYS LOG_CORE
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "helper.h"
+#include "process.h"
+#include "stats.h"
+#include "trace.h"
+
+/**
+ * @file process.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Starting other programs.
+ *
+ * Children are started with posix_spawn(), which doesn't copy howm's address
+ * space the way that fork() does. None of howm's file descriptors are passed
+ * on, as each is marked close-on-exec with set_cloexec() when it is opened.
+ *
+ * SIGCHLD is blocked and read from a signalfd in the main loop, where
+ * children are reaped. The most recent children are remembered, along with
+ * how long each took to map a window (matched using _NET_WM_PID).
+ */
+
+/**
+ * @brief A child that howm has started.
+ */
+struct child {
+	pid_t pid; /**< The child's PID, or 0 if the slot is unused. */
+	char cmd[PROCESS_CMD_LEN]; /**< The command, truncated if too long. */
+	uint64_t start_us; /**< When the child was started. */
+	uint64_t map_us; /**< When it first mapped a window, or 0. */
+	xcb_window_t win; /**< The first window it mapped. */
+	bool exited; /**< Whether the child has been reaped. */
+	int status; /**< The status from waitpid(), once exited. */
+};
+
+extern char **environ;
+
+static struct child children[PROCESS_MAX_CHILDREN];
+/** The amount of children ever started, the next is stored at
+ * nr_children % PROCESS_MAX_CHILDREN. */
+static unsigned long nr_children;
+static int sig_fd = -1;
+
+/**
+ * @brief Block SIGCHLD and create a signalfd to receive it, so that children
+ * can be reaped from the main loop.
+ *
+ * This must be called before any children are started.
+ *
+ * @return The signalfd, or -1 if it couldn't be created. Without it, children
+ * aren't reaped until howm exits.
+ */
+int process_init(void)
+{
+	sigset_t mask;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) {
+		log_err("Couldn't block SIGCHLD, children won't be reaped");
+		return -1;
+	}
+	sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (sig_fd == -1) {
+		log_err("Couldn't create a signalfd, children won't be reaped");
+		sigprocmask(SIG_UNBLOCK, &mask, NULL);
+	}
+	return sig_fd;
+}
+
+/**
+ * @brief Find the most recent child with a given PID.
+ *
+ * @param pid The PID to search for.
+ *
+ * @return The child, or NULL if it isn't remembered.
+ */
+static struct child *find_child(pid_t pid)
+{
+	unsigned long i = nr_children;
+	unsigned long oldest = nr_children > PROCESS_MAX_CHILDREN
+		? nr_children - PROCESS_MAX_CHILDREN : 0;
+
+	/* PIDs are reused, so search from newest to oldest. */
+	while (i-- > oldest)
+		if (children[i % PROCESS_MAX_CHILDREN].pid == pid)
+			return &children[i % PROCESS_MAX_CHILDREN];
+	return NULL;
+}
+
+/**
+ * @brief Remember a child that has just been started.
+ *
+ * @param pid The child's PID.
+ * @param argv The command that the child is running.
+ * @param start_us When the child was started.
+ */
+static void add_child(pid_t pid, char *const argv[], uint64_t start_us)
+{
+	struct child *c = &children[nr_children++ % PROCESS_MAX_CHILDREN];
+	size_t len = 0;
+
+	memset(c, 0, sizeof(*c));
+	c->pid = pid;
+	c->start_us = start_us;
+	for (; *argv && len < sizeof(c->cmd) - 1; argv++)
+		len += snprintf(c->cmd + len, sizeof(c->cmd) - len, "%s%s",
+				len ? " " : "", *argv);
+}
+
+/**
+ * @brief Run a program in its own session, with an empty signal mask.
+ *
+ * @param argv The program and its arguments, terminated by NULL. The program
+ * is searched for in PATH unless it contains a '/'.
+ *
+ * @return The PID of the child, or -1 if it couldn't be started.
+ */
+pid_t process_spawn(char *const argv[])
+{
+	posix_spawnattr_t attr;
+	short flags = POSIX_SPAWN_SETSIGMASK;
+	sigset_t none;
+	uint64_t start_us = stats_now_us();
+	pid_t pid;
+	int err;
+
+#ifdef POSIX_SPAWN_SETSID
+	flags |= POSIX_SPAWN_SETSID;
+#endif
+	sigemptyset(&none);
+	err = posix_spawnattr_init(&attr);
+	if (!err) {
+		err = posix_spawnattr_setflags(&attr, flags);
+		if (!err)
+			err = posix_spawnattr_setsigmask(&attr, &none);
+		if (!err)
+			err = posix_spawnp(&pid, argv[0], NULL, &attr, argv,
+					environ);
+		posix_spawnattr_destroy(&attr);
+	}
+
+	if (err) {
+		log_err("Couldn't spawn %s: %s", argv[0], strerror(err));
+		return -1;
+	}
+	log_info("Spawned %s as pid %d", argv[0], (int)pid);
+	TRACE(TR_SPAWN, pid);
+	add_child(pid, argv, start_us);
+	return pid;
+}
+
+/**
+ * @brief Reap every child that has exited, recording its exit status. This
+ * should be called when the signalfd is readable.
+ */
+void process_reap(void)
+{
+	struct signalfd_siginfo si;
+	struct child *c;
+	pid_t pid;
+	int status;
+
+	/* Several SIGCHLDs can be merged into one, so drain the signalfd and
+	 * then reap until there is nothing left. */
+	while (read(sig_fd, &si, sizeof(si)) == sizeof(si))
+		;
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		TRACE(TR_EXIT, pid, status);
+		c = find_child(pid);
+		if (!c || c->exited)
+			continue;
+		c->exited = true;
+		c->status = status;
+		log_info("%s (pid %d) exited with status %d", c->cmd, (int)pid,
+				status);
+	}
+}
+
+/**
+ * @brief Note that a window has been mapped by a process, so that the time
+ * from starting a child to it mapping its first window is known.
+ *
+ * @param pid The PID from the window's _NET_WM_PID.
+ * @param win The window.
+ */
+void process_mapped(pid_t pid, xcb_window_t win)
+{
+	struct child *c = find_child(pid);
+
+	if (!c || c->map_us)
+		return;
+	c->map_us = stats_now_us();
+	c->win = win;
+	log_info("%s (pid %d) mapped 0x%x after %llu us", c->cmd, (int)pid, win,
+			(unsigned long long)(c->map_us - c->start_us));
+}
+
+/**
+ * @brief Print the children that howm remembers, oldest first.
+ *
+ * Each line is of the form:
+ *
+ *	pid status map_us command
+ *
+ * status is "running", "exited:CODE" or "killed:SIGNAL". map_us is the time
+ * from starting the child until it mapped a window, or "-" if it hasn't.
+ *
+ * @param f Where to print the children.
+ */
+void process_print(FILE *f)
+{
+	const struct child *c;
+	unsigned long i = nr_children > PROCESS_MAX_CHILDREN
+		? nr_children - PROCESS_MAX_CHILDREN : 0;
+
+	fprintf(f, "pid status map_us command\n");
+	for (; i < nr_children; i++) {
+		c = &children[i % PROCESS_MAX_CHILDREN];
+		fprintf(f, "%d ", (int)c->pid);
+		if (!c->exited)
+			fprintf(f, "running ");
+		else if (WIFSIGNALED(c->status))
+			fprintf(f, "killed:%d ", WTERMSIG(c->status));
+		else
+			fprintf(f, "exited:%d ", WEXITSTATUS(c->status));
+		if (c->map_us)
+			fprintf(f, "%llu ",
+				(unsigned long long)(c->map_us - c->start_us));
+		else
+			fprintf(f, "- ");
+		fprintf(f, "%s\n", c->cmd);
+	}
+}
+
+/**
+ * @brief Mark a file descriptor as close-on-exec, so that it isn't leaked into
+ * children.
+ *
+ * @param fd The file descriptor.
+ */
+void set_cloexec(int fd)
+{
+	int flags = fcntl(fd, F_GETFD);
+
+	if (flags == -1 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1)
+		log_err("Couldn't set close-on-exec on fd %d", fd);
+}
@@ -0,0 +1,31 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <xcb/xcb.h>
+
+/**
+ * @file process.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** How many children are remembered, after that the oldest is forgotten. */
+#define PROCESS_MAX_CHILDREN 64
+/** The longest command that is remembered for a child, including the
+ * terminator. */
+#define PROCESS_CMD_LEN 64
+
+int process_init(void);
+pid_t process_spawn(char *const argv[]);
+void process_reap(void);
+void process_mapped(pid_t pid, xcb_window_t win);
+void process_print(FILE *f);
+void set_cloexec(int fd);
+
+#endif
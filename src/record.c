@@ -0,0 +1,250 @@
+#define _POSIX_C_SOURCE 200809L
+#define LOG_SUBSYS LOG_CORE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#include "backend.h"
+#include "configure.h"
+#include "drag.h"
+#include "handler.h"
+#include "helper.h"
+#include "howm.h"
+#include "ipc.h"
+#include "process.h"
+#include "record.h"
+#include "stats.h"
+
+/**
+ * @file record.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Recording the X events and IPC messages that howm receives, and
+ * replaying them later.
+ *
+ * A recording starts with RECORD_MAGIC and the screen's width and height (as
+ * uint16_t), followed by records. Each record is a struct record_hdr and then
+ * the record's data:
+ *
+ * - REC_EVENT: An X event, as returned by xcb_poll_for_event().
+ * - REC_IPC: A message, as read from howm's socket.
+ * - REC_WIN_INFO: The window and struct xwin_info that howm was told about a
+ *   window that asked to be mapped, so that the mock backend can give the
+ *   same answer when replaying.
+ *
+ * Recordings are only replayed with the mock backend, as the recorded windows
+ * don't exist on any other X server.
+ *
+ * Records are written in the machine's byte order, so a recording should be
+ * replayed by a build of howm for the same architecture.
+ */
+
+/**
+ * @brief The data of a REC_WIN_INFO record.
+ */
+struct record_win {
+	xcb_window_t win;
+	struct xwin_info info;
+};
+
+static FILE *rec;
+static uint64_t rec_start;
+static FILE *play;
+
+/**
+ * @brief Start recording to a file, replacing anything that is already there.
+ *
+ * This must be called after the screen's size is known.
+ *
+ * @param path The file to record to.
+ *
+ * @return True if the file could be created.
+ */
+bool record_open(const char *path)
+{
+	uint16_t dims[] = { screen_width, screen_height };
+
+	rec = fopen(path, "wb");
+	if (!rec) {
+		log_err("Couldn't open %s for recording", path);
+		return false;
+	}
+	set_cloexec(fileno(rec));
+	if (fwrite(RECORD_MAGIC, strlen(RECORD_MAGIC), 1, rec) != 1
+			|| fwrite(dims, sizeof(dims), 1, rec) != 1) {
+		log_err("Couldn't write to %s", path);
+		record_close();
+		return false;
+	}
+	rec_start = stats_now_us();
+	return true;
+}
+
+/**
+ * @brief Stop recording.
+ */
+void record_close(void)
+{
+	if (rec)
+		fclose(rec);
+	rec = NULL;
+}
+
+/**
+ * @brief Write any buffered records to the recording.
+ */
+void record_flush(void)
+{
+	if (rec)
+		fflush(rec);
+}
+
+/**
+ * @brief Append a record to the recording. Recording stops if the write
+ * fails.
+ *
+ * @param type The type of the record.
+ * @param data The record's data.
+ * @param len The length of data.
+ */
+static void record_write(enum record_type type, const void *data, uint32_t len)
+{
+	struct record_hdr hdr = { stats_now_us() - rec_start, type, len };
+
+	if (fwrite(&hdr, sizeof(hdr), 1, rec) != 1
+			|| fwrite(data, len, 1, rec) != 1) {
+		log_err("Couldn't write to the recording, stopping");
+		record_close();
+	}
+}
+
+/**
+ * @brief Record an X event, if recording.
+ *
+ * @param ev The event.
+ */
+void record_event(const xcb_generic_event_t *ev)
+{
+	if (rec)
+		record_write(REC_EVENT, ev, sizeof(*ev));
+}
+
+/**
+ * @brief Record an IPC message, if recording.
+ *
+ * @param msg The message, as read from the socket.
+ * @param len The length of the message.
+ */
+void record_ipc(const char *msg, uint32_t len)
+{
+	if (rec)
+		record_write(REC_IPC, msg, len);
+}
+
+/**
+ * @brief Record what is known about a window that wants to be mapped, if
+ * recording.
+ *
+ * @param win The window.
+ * @param info What the backend reported about the window.
+ */
+void record_window_info(xcb_window_t win, const struct xwin_info *info)
+{
+	struct record_win rw;
+
+	if (!rec)
+		return;
+	memset(&rw, 0, sizeof(rw));
+	rw.win = win;
+	rw.info = *info;
+	record_write(REC_WIN_INFO, &rw, sizeof(rw));
+}
+
+/**
+ * @brief Open a recording to be replayed.
+ *
+ * @param path The recording.
+ * @param width Where to store the width of the recorded screen.
+ * @param height Where to store the height of the recorded screen.
+ *
+ * @return True if path is a recording.
+ */
+bool replay_open(const char *path, uint16_t *width, uint16_t *height)
+{
+	char magic[sizeof(RECORD_MAGIC) - 1];
+	uint16_t dims[2];
+
+	play = fopen(path, "rb");
+	if (!play) {
+		log_err("Couldn't open the recording %s", path);
+		return false;
+	}
+	if (fread(magic, sizeof(magic), 1, play) != 1
+			|| memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0
+			|| fread(dims, sizeof(dims), 1, play) != 1) {
+		log_err("%s isn't a recording", path);
+		fclose(play);
+		play = NULL;
+		return false;
+	}
+	*width = dims[0];
+	*height = dims[1];
+	return true;
+}
+
+/**
+ * @brief Feed every record of the opened recording into howm, as quickly as
+ * possible, then print how long it took to stderr.
+ *
+ * Events go to handle_event() and IPC messages to ipc_process(), exactly as
+ * if they had been received by the main loop. The mock backend must be in
+ * use.
+ */
+void replay_run(void)
+{
+	union {
+		xcb_generic_event_t ev;
+		struct record_win rw;
+		char msg[IPC_BUF_SIZE];
+	} buf;
+	struct record_hdr hdr;
+	unsigned long nr_events = 0, nr_msgs = 0;
+	uint64_t start = stats_now_us();
+
+	while (fread(&hdr, sizeof(hdr), 1, play) == 1) {
+		if (hdr.len >= sizeof(buf)) {
+			log_warn("Skipping a record of %u bytes", hdr.len);
+			fseek(play, hdr.len, SEEK_CUR);
+			continue;
+		}
+		if (fread(&buf, hdr.len, 1, play) != 1)
+			break;
+
+		if (hdr.type == REC_EVENT && hdr.len == sizeof(buf.ev)) {
+			handle_event(&buf.ev);
+			drag_flush();
+			nr_events++;
+		} else if (hdr.type == REC_IPC) {
+			buf.msg[hdr.len] = '\0';
+			ipc_respond(-1, ipc_process(buf.msg, hdr.len));
+			nr_msgs++;
+		} else if (hdr.type == REC_WIN_INFO) {
+			mock_set_window_info(buf.rw.win, &buf.rw.info);
+		}
+		configure_commit();
+		xb->flush();
+	}
+
+	fprintf(stderr, "Replayed %lu events and %lu IPC messages in %llu us\n",
+		nr_events, nr_msgs,
+		(unsigned long long)(stats_now_us() - start));
+	fclose(play);
+	play = NULL;
+}
@@ -0,0 +1,44 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+#include "backend.h"
+
+/**
+ * @file record.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** Identifies a recording, and the version of its format. */
+#define RECORD_MAGIC "HOWMREC2"
+
+/** The kinds of record stored in a recording. */
+enum record_type { REC_EVENT = 1, REC_IPC, REC_WIN_INFO };
+
+/**
+ * @brief Precedes each record in a recording.
+ */
+struct record_hdr {
+	uint64_t us; /**< Microseconds since the recording started. */
+	uint32_t type; /**< One of enum record_type. */
+	uint32_t len; /**< The amount of data that follows. */
+};
+
+bool record_open(const char *path);
+void record_close(void);
+void record_flush(void);
+void record_event(const xcb_generic_event_t *ev);
+void record_ipc(const char *msg, uint32_t len);
+void record_window_info(xcb_window_t win, const struct xwin_info *info);
+bool replay_open(const char *path, uint16_t *width, uint16_t *height);
+void replay_run(void);
+
+#endif
@@ -1,11 +1,20 @@
+#define LOG_SUBSYS LOG_CLIENT
+
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <xcb/xcb.h>
 #include <xcb/xproto.h>
 
+#include "backend.h"
 #include "scratchpad.h"
 #include "client.h"
+#include "configure.h"
 #include "helper.h"
 #include "howm.h"
+#include "layout.h"
+#include "location.h"
+#include "xcb_help.h"
 
 /**
  * @file scratchpad.c
@@ -18,8 +27,30 @@
  * sending clients (or groups of clients) to the scratchpad.
  */
 
+/**
+ * @brief A named scratchpad slot, holding a single client.
+ *
+ * Hidden scratchpads are parked: their window stays mapped, but is moved
+ * outside of the root window and isn't part of any workspace's client list.
+ * Showing a parked scratchpad is then just a configure and a restack, rather
+ * than a map (which would force the client to repaint).
+ */
+typedef struct scratchpad_t scratchpad_t;
+struct scratchpad_t {
+	char name[SCRATCHPAD_NAME_LEN]; /**< The name used to refer to the slot. */
+	client_t *c; /**< The client stored in this slot. */
+	bool hidden; /**< Is the client parked? If not, it is on a workspace. */
+	scratchpad_t *next; /**< The next slot in the linked list. */
+};
+
 struct stack del_reg;
-static client_t *scratchpad;
+static scratchpad_t *scratchpads;
+
+static scratchpad_t *find_scratchpad(const char *name);
+static scratchpad_t *find_scratchpad_client(const client_t *c);
+static void free_scratchpad(scratchpad_t *sp);
+static void show_scratchpad(scratchpad_t *sp, bool map);
+static void hide_scratchpad(scratchpad_t *sp);
 
 /**
  * @brief Dynamically allocate space for the contents of the stack.
@@ -28,14 +59,18 @@ static client_t *scratchpad;
  * need to allocate it dynamically.
  *
  * @param s The stack that needs to have its contents allocated.
+ * @param cap The amount of runs that the stack can hold.
  */
-void stack_init(struct stack *s)
+void stack_init(struct stack *s, unsigned int cap)
 {
-	s->contents = (client_t **)malloc(sizeof(client_t) * conf.delete_register_size);
+	s->contents = calloc(cap, sizeof(struct client_run));
 	if (!s->contents) {
 		log_err("Failed to allocate memory for stack.");
 		exit(EXIT_FAILURE);
 	}
+	s->cap = cap;
+	s->size = 0;
+	s->bottom = 0;
 }
 
 /**
@@ -47,24 +82,91 @@ void stack_free(struct stack *s)
 {
 	free(s->contents);
 	s->contents = NULL;
+	s->cap = s->size = s->bottom = 0;
 }
 
 /**
- * @brief Pushes a client onto the stack, as long as it isn't full.
+ * @brief Give the clients of a run that has fallen off the bottom of the stack
+ * back to the current workspace, so that their windows aren't lost.
  *
- * @param s The stack.
- * @param c The client to be pushed on. This client is treated as the head of a
- * linked list.
+ * @param run The run that has been evicted.
+ */
+static void stack_evict(struct client_run run)
+{
+	client_t *c, *t;
+
+	log_warn("Delete register is full, restoring %u clients", run.cnt);
+	for (c = run.head; c; c = c->next) {
+		c->is_tab_hidden = false;
+		xb->map_window(c->win);
+	}
+	if (!mon->ws->head) {
+		mon->ws->head = run.head;
+	} else {
+		/* prev_client() can't find the tail of a single client list. */
+		for (t = mon->ws->head; t->next; t = t->next)
+			;
+		t->next = run.head;
+	}
+	if (!mon->ws->c)
+		mon->ws->c = run.head;
+	mon->ws->client_cnt += run.cnt;
+	arrange_windows(mon);
+}
+
+/**
+ * @brief Change the amount of runs that a stack can hold.
+ *
+ * If the stack is shrunk below its current size, the runs at the bottom are
+ * evicted.
+ *
+ * @param s The stack to be resized.
+ * @param cap The new capacity of the stack. Must be at least one.
  */
-void stack_push(struct stack *s, client_t *c)
+void stack_resize(struct stack *s, unsigned int cap)
 {
-	if (!c || !s) {
+	struct client_run *contents;
+	unsigned int i;
+
+	if (cap == s->cap || cap == 0)
+		return;
+	contents = calloc(cap, sizeof(struct client_run));
+	if (!contents) {
+		log_err("Failed to allocate memory for stack.");
 		return;
-	} else if (s->size >= conf.delete_register_size) {
-		log_warn("Can't push <%p> onto stack <%p>- it is full", c, s);
+	}
+
+	for (; s->size > cap; s->size--) {
+		stack_evict(s->contents[s->bottom]);
+		s->bottom = (s->bottom + 1) % s->cap;
+	}
+	for (i = 0; i < s->size; i++)
+		contents[i] = s->contents[(s->bottom + i) % s->cap];
+
+	log_info("Resized stack <%p> from %u to %u", s, s->cap, cap);
+	free(s->contents);
+	s->contents = contents;
+	s->cap = cap;
+	s->bottom = 0;
+}
+
+/**
+ * @brief Pushes a run of clients onto the stack. If the stack is full, the
+ * run at the bottom of the stack is evicted.
+ *
+ * @param s The stack.
+ * @param run The run of clients to be pushed on.
+ */
+void stack_push(struct stack *s, struct client_run run)
+{
+	if (!s || !s->cap || !run.head)
 		return;
+	if (s->size == s->cap) {
+		stack_evict(s->contents[s->bottom]);
+		s->bottom = (s->bottom + 1) % s->cap;
+		s->size--;
 	}
-	s->contents[++(s->size)] = c;
+	s->contents[(s->bottom + s->size++) % s->cap] = run;
 }
 
 /**
@@ -72,82 +174,286 @@ void stack_push(struct stack *s, client_t *c)
  *
  * @param s The stack to be popped from.
  *
- * @return The client that was at the top of the stack. It acts as the head of
- * the linked list of clients.
+ * @return The run that was at the top of the stack. The run is empty if the
+ * stack was empty.
  */
-client_t *stack_pop(struct stack *s)
+struct client_run stack_pop(struct stack *s)
 {
+	struct client_run run = { NULL, NULL, 0 };
+
 	if (!s) {
-		return NULL;
+		return run;
 	} else if (s->size == 0) {
 		log_warn("Can't pop from stack <%p> as it is empty.", s);
-		return NULL;
+		return run;
 	}
-	return s->contents[(s->size)--];
+	return s->contents[(s->bottom + --s->size) % s->cap];
+}
+
+/**
+ * @brief Find the scratchpad slot with the given name.
+ *
+ * @param name The name of the slot. NULL refers to the default slot.
+ *
+ * @return The slot or NULL if no slot of that name exists.
+ */
+static scratchpad_t *find_scratchpad(const char *name)
+{
+	scratchpad_t *sp;
+
+	if (!name)
+		name = SCRATCHPAD_DEF_NAME;
+	for (sp = scratchpads; sp; sp = sp->next)
+		if (strcmp(sp->name, name) == 0)
+			return sp;
+	return NULL;
+}
+
+/**
+ * @brief Find the scratchpad slot that holds a client.
+ *
+ * @param c The client to search for.
+ *
+ * @return The slot or NULL if the client isn't in a scratchpad.
+ */
+static scratchpad_t *find_scratchpad_client(const client_t *c)
+{
+	scratchpad_t *sp;
+
+	for (sp = scratchpads; sp; sp = sp->next)
+		if (sp->c == c)
+			return sp;
+	return NULL;
 }
 
 /**
- * @brief Send a client to the scratchpad and unmap it.
+ * @brief Unlink a slot from the list of scratchpads and free it.
+ *
+ * The client held by the slot is not freed.
+ *
+ * @param sp The slot to be freed.
+ */
+static void free_scratchpad(scratchpad_t *sp)
+{
+	scratchpad_t **temp;
+
+	for (temp = &scratchpads; *temp; temp = &(*temp)->next)
+		if (*temp == sp) {
+			*temp = sp->next;
+			break;
+		}
+	free(sp);
+}
+
+/**
+ * @brief Bring a scratchpad's client onto the current workspace, floating in
+ * the center of the monitor.
+ *
+ * The geometry and stacking order are set with a single request.
+ *
+ * @param sp The slot to be shown. Its client mustn't be in a client list.
+ * @param map Whether the window needs mapping. Parked windows are still
+ * mapped.
+ */
+static void show_scratchpad(scratchpad_t *sp, bool map)
+{
+	client_t *c = sp->c;
+	uint32_t vals[] = { 0, 0, conf.scratchpad_width,
+			    conf.scratchpad_height, XCB_STACK_MODE_ABOVE };
+
+	c->is_floating = true;
+	c->rect.width = conf.scratchpad_width;
+	c->rect.height = conf.scratchpad_height;
+	c->rect.x = mon->rect.x + (mon->rect.width / 2) - (c->rect.width / 2);
+	c->rect.y = mon->rect.y + (mon->rect.height - mon->ws->bar_height - c->rect.height) / 2;
+	vals[0] = c->rect.x;
+	vals[1] = c->rect.y;
+
+	log_info("Showing scratchpad <%s> with client <%p>", sp->name, c);
+	queue_configure(c->win, MOVE_RESIZE_MASK | XCB_CONFIG_WINDOW_STACK_MODE,
+			vals);
+	if (map)
+		xb->map_window(c->win);
+	sp->hidden = false;
+	attach_client(mon->ws, c);
+	update_focused_client(c);
+}
+
+/**
+ * @brief Take a scratchpad's client off of the current workspace and park it
+ * outside of the visible area.
+ *
+ * @param sp The slot to be hidden. Its client must be on the current
+ * workspace.
+ */
+static void hide_scratchpad(scratchpad_t *sp)
+{
+	if (!detach_client(mon, mon->ws, sp->c))
+		return;
+
+	log_info("Hiding scratchpad <%s> with client <%p>", sp->name, sp->c);
+	sp->hidden = true;
+	/* Everything to the right of the root window's width is off-screen for
+	 * every monitor. */
+	move_resize(sp->c->win, screen_width, 0, sp->c->rect.width,
+		    sp->c->rect.height);
+	if (!FFT(sp->c))
+		arrange_windows(mon);
+	if (!mon->ws->c)
+		focus_root();
+}
+
+/**
+ * @brief Forget about a client that is being freed elsewhere.
+ *
+ * This is called whenever a client is removed, so that a scratchpad slot
+ * doesn't keep a dangling pointer to it.
+ *
+ * @param c The client that is being removed.
+ */
+void scratchpad_release(client_t *c)
+{
+	scratchpad_t *sp = find_scratchpad_client(c);
+
+	if (sp)
+		free_scratchpad(sp);
+}
+
+/**
+ * @brief Free a parked client whose window has been destroyed.
+ *
+ * Parked clients aren't in any client list, so loc_win() won't find them.
+ *
+ * @param win The window that was destroyed.
+ *
+ * @return True if the window belonged to a parked scratchpad.
+ */
+bool scratchpad_destroy_win(xcb_window_t win)
+{
+	scratchpad_t *sp;
+
+	for (sp = scratchpads; sp; sp = sp->next)
+		if (sp->hidden && sp->c->win == win) {
+			log_info("Parked scratchpad <%s> was destroyed", sp->name);
+			free(sp->c);
+			free_scratchpad(sp);
+			return true;
+		}
+	return false;
+}
+
+/**
+ * @brief Free all scratchpad slots and their parked clients.
+ */
+void scratchpad_free_all(void)
+{
+	while (scratchpads) {
+		if (scratchpads->hidden)
+			free(scratchpads->c);
+		free_scratchpad(scratchpads);
+	}
+}
+
+/**
+ * @brief Send the current client to a named scratchpad and hide it.
+ *
+ * @param name The name of the scratchpad. If NULL, the default scratchpad is
+ * used. A scratchpad can only hold one client at a time.
  *
  * @ingroup commands
  */
-void send_to_scratchpad(void)
+void send_to_scratchpad(char *name)
 {
 	client_t *c = mon->ws->c;
+	scratchpad_t *sp;
 
-	if (scratchpad || !c)
+	if (!c)
 		return;
+	if (!name)
+		name = SCRATCHPAD_DEF_NAME;
+	if (strlen(name) >= SCRATCHPAD_NAME_LEN) {
+		log_warn("Scratchpad name <%s> is too long", name);
+		return;
+	}
+	sp = find_scratchpad(name);
+	if (sp && sp->c == c) {
+		hide_scratchpad(sp);
+		return;
+	} else if (sp) {
+		log_warn("Scratchpad <%s> is already in use", name);
+		return;
+	}
+	/* Move it out of any other slot that it may be bound to. */
+	scratchpad_release(c);
 
-	log_info("Sending client <%p> to scratchpad", c);
-	if (prev_client(c, mon->ws))
-		prev_client(c, mon->ws)->next = c->next;
-
-	/* TODO: This should be in a reusable function. */
-	if (c == mon->ws->prev_foc)
-		mon->ws->prev_foc = prev_client(mon->ws->c, mon->ws);
-	if (c == mon->ws->c || !mon->ws->head->next)
-		mon->ws->c = mon->ws->prev_foc ? mon->ws->prev_foc : mon->ws->head;
-	if (c == mon->ws->head) {
-		mon->ws->head = c->next;
-		mon->ws->c = c->next;
+	sp = calloc(1, sizeof(scratchpad_t));
+	if (!sp) {
+		log_err("Can't allocate memory for scratchpad.");
+		return;
 	}
+	snprintf(sp->name, sizeof(sp->name), "%s", name);
+	sp->c = c;
+	sp->next = scratchpads;
+	scratchpads = sp;
 
-	xcb_unmap_window(dpy, c->win);
-	mon->ws->client_cnt--;
-	update_focused_client(mon->ws->c);
-	scratchpad = c;
+	log_info("Sending client <%p> to scratchpad <%s>", c, sp->name);
+	c->rect.width = conf.scratchpad_width;
+	c->rect.height = conf.scratchpad_height;
+	hide_scratchpad(sp);
 }
 
 /**
- * @brief Get a client from the scratchpad, attach it as the last item in the
- * client list and set it to float.
+ * @brief Get a client from a named scratchpad, attach it as the last item in
+ * the client list and set it to float.
+ *
+ * The scratchpad is then empty and can be reused.
+ *
+ * @param name The name of the scratchpad. If NULL, the default scratchpad is
+ * used.
+ *
+ * @ingroup commands
+ */
+void get_from_scratchpad(char *name)
+{
+	scratchpad_t *sp = find_scratchpad(name);
+	client_t *c;
+
+	if (!sp)
+		return;
+	c = sp->c;
+	if (sp->hidden)
+		show_scratchpad(sp, false);
+	free_scratchpad(sp);
+	log_info("Took client <%p> out of scratchpad", c);
+}
+
+/**
+ * @brief Show or hide a named scratchpad, keeping its client bound to it.
+ *
+ * If the scratchpad is visible on another workspace, it is brought to the
+ * current one instead of being hidden.
+ *
+ * @param name The name of the scratchpad. If NULL, the default scratchpad is
+ * used.
  *
  * @ingroup commands
  */
-void get_from_scratchpad(void)
+void toggle_scratchpad(char *name)
 {
-	if (!scratchpad)
+	scratchpad_t *sp = find_scratchpad(name);
+	location_t loc;
+
+	if (!sp) {
 		return;
-	/* TODO: This should be in a reusable function. */
-	if (!mon->ws->head)
-		mon->ws->head = scratchpad;
-	else if (!mon->ws->head->next)
-		mon->ws->head->next = scratchpad;
-	else
-		prev_client(mon->ws->head, mon->ws)->next = scratchpad;
-
-	mon->ws->prev_foc = mon->ws->c;
-	mon->ws->c = scratchpad;
-
-	scratchpad = NULL;
-	mon->ws->client_cnt++;
-
-	mon->ws->c->is_floating = true;
-	mon->ws->c->rect.width = conf.scratchpad_width;
-	mon->ws->c->rect.height = conf.scratchpad_height;
-	mon->ws->c->rect.x = (mon->rect.width / 2) - (mon->ws->c->rect.width / 2);
-	mon->ws->c->rect.y = (mon->rect.height - mon->ws->bar_height - mon->ws->c->rect.height) / 2;
-
-	xcb_map_window(dpy, mon->ws->c->win);
-	update_focused_client(mon->ws->c);
+	} else if (sp->hidden) {
+		show_scratchpad(sp, false);
+	} else if (loc_client(&loc, sp->c)) {
+		if (loc.ws == mon->ws) {
+			hide_scratchpad(sp);
+		} else {
+			detach_client(loc.mon, loc.ws, sp->c);
+			/* Clients on hidden workspaces have been unmapped. */
+			show_scratchpad(sp, loc.mon->ws != loc.ws);
+		}
+	}
 }
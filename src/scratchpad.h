@@ -1,6 +1,9 @@
 #ifndef SCRATCHPAD_H
 #define SCRATCHPAD_H
 
+#include <stdbool.h>
+#include <xcb/xproto.h>
+
 #include "types.h"
 
 /**
@@ -13,9 +16,27 @@
  * @brief howm
  */
 
+/** The scratchpad that is used when a command isn't given a name. */
+#define SCRATCHPAD_DEF_NAME "default"
+/** The maximum length of a scratchpad's name, including the terminator. */
+#define SCRATCHPAD_NAME_LEN 32
+/** The largest amount of runs that the delete register can be resized to. */
+#define DEL_REG_MAX_SIZE 128
+
+/**
+ * @brief A run of clients, linked together through their next pointers. The
+ * tail is stored so that the run can be spliced into a client list without
+ * walking it.
+ */
+struct client_run {
+	client_t *head; /**< The first client in the run. */
+	client_t *tail; /**< The last client in the run, its next is NULL. */
+	unsigned int cnt; /**< The amount of clients in the run. */
+};
+
 /**
- * @brief Represents a stack. This stack is going to hold linked lists of
- * clients. An example of the stack is below:
+ * @brief Represents a stack. This stack is going to hold runs of clients. An
+ * example of the stack is below:
  *
  * TOP
  * ==========
@@ -27,20 +48,29 @@
  * ==========
  * BOTTOM
  *
+ * The stack is stored in a ring buffer, so that when it is full the bottom
+ * item is evicted to make room for a new one.
  */
 struct stack {
 	unsigned int size; /**< The amount of items in the stack. */
-	client_t **contents; /**< The contents is an array of linked lists. Storage
-			is malloced later as we don't know the size yet.*/
+	unsigned int cap; /**< The amount of items that the stack can hold. */
+	unsigned int bottom; /**< The index of the bottom item in contents. */
+	struct client_run *contents; /**< The ring buffer of runs. Storage is
+			malloced later as we don't know the size yet.*/
 };
 
 extern struct stack del_reg;
 
-void stack_push(struct stack *s, client_t *c);
-client_t *stack_pop(struct stack *s);
-void stack_init(struct stack *s);
+void stack_push(struct stack *s, struct client_run run);
+struct client_run stack_pop(struct stack *s);
+void stack_init(struct stack *s, unsigned int cap);
+void stack_resize(struct stack *s, unsigned int cap);
 void stack_free(struct stack *s);
-void send_to_scratchpad(void);
-void get_from_scratchpad(void);
+void send_to_scratchpad(char *name);
+void get_from_scratchpad(char *name);
+void toggle_scratchpad(char *name);
+void scratchpad_release(client_t *c);
+bool scratchpad_destroy_win(xcb_window_t win);
+void scratchpad_free_all(void);
 
 #endif
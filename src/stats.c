@@ -0,0 +1,257 @@
+#define _POSIX_C_SOURCE 200809L
+#define LOG_SUBSYS LOG_CORE
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "helper.h"
+#include "howm.h"
+#include "stats.h"
+#include "trace.h"
+
+/**
+ * @file stats.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Accounting of the X requests that howm sends, the time it spends
+ * waiting for replies and how long each event handler and IPC command takes
+ * to run.
+ *
+ * Run times are kept in a log-linear histogram, in the style of HdrHistogram:
+ * values below 2 * STATS_HIST_SUB each get their own slot, after which every
+ * power of two is split into STATS_HIST_SUB slots. Recording a value is a
+ * couple of shifts, and any percentile can be read back to within 1/8th of
+ * its true value.
+ */
+
+static struct stats buckets[STATS_MAX_BUCKETS];
+static unsigned int nr_buckets;
+/** Traffic that isn't caused by a handler or command, such as setup. */
+static struct stats other = { .name = "other" };
+static struct stats *cur = &other;
+static uint64_t wait_start;
+static uint64_t run_start;
+
+/**
+ * @brief Read a clock that is never adjusted.
+ *
+ * @return The current time in microseconds.
+ */
+uint64_t stats_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Start accounting X traffic to a handler or command.
+ *
+ * @param name The name of the handler or command.
+ */
+void stats_begin(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_buckets; i++)
+		if (strncmp(buckets[i].name, name, STATS_NAME_LEN - 1) == 0)
+			break;
+
+	if (i == nr_buckets && nr_buckets < STATS_MAX_BUCKETS)
+		snprintf(buckets[nr_buckets++].name, STATS_NAME_LEN, "%s", name);
+
+	cur = i < nr_buckets ? &buckets[i] : &other;
+	cur->calls++;
+	run_start = stats_now_us();
+}
+
+/**
+ * @brief Find the histogram slot that a latency is counted in.
+ *
+ * @param us The latency in microseconds.
+ *
+ * @return The index of the slot.
+ */
+static unsigned int hist_slot(uint64_t us)
+{
+	unsigned int shift, slot;
+
+	if (us < 2 * STATS_HIST_SUB)
+		return us;
+	shift = 63 - __builtin_clzll(us) - STATS_HIST_SUB_BITS;
+	slot = (shift + 1) * STATS_HIST_SUB + (us >> shift) - STATS_HIST_SUB;
+	return slot < STATS_HIST_SLOTS ? slot : STATS_HIST_SLOTS - 1;
+}
+
+/**
+ * @brief The highest latency that is counted in a histogram slot.
+ *
+ * @param slot The index of the slot.
+ *
+ * @return The latency in microseconds.
+ */
+static uint64_t hist_slot_max(unsigned int slot)
+{
+	unsigned int shift;
+
+	if (slot < 2 * STATS_HIST_SUB)
+		return slot;
+	shift = slot / STATS_HIST_SUB - 1;
+	return (((uint64_t)(slot % STATS_HIST_SUB + STATS_HIST_SUB + 1))
+			<< shift) - 1;
+}
+
+/**
+ * @brief Stop accounting to the current handler or command, and record how
+ * long it took to run.
+ *
+ * If it took longer than conf.slow_event_us, a warning and the trace are
+ * written to stderr, showing what howm was doing.
+ */
+void stats_end(void)
+{
+	uint64_t us = stats_now_us() - run_start;
+
+	cur->total_us += us;
+	if (us > cur->max_us)
+		cur->max_us = us;
+	cur->hist[hist_slot(us)]++;
+
+	if (conf.slow_event_us && us > conf.slow_event_us) {
+		log_warn("%s took %llu us, over the budget of %u us", cur->name,
+			 (unsigned long long)us, conf.slow_event_us);
+		trace_dump(stderr);
+	}
+	cur = &other;
+}
+
+/**
+ * @brief Count a request. Use XREQ() rather than calling this directly.
+ */
+void stats_request(void)
+{
+	cur->requests++;
+}
+
+/**
+ * @brief Call this just before blocking on a reply from the X server.
+ */
+void stats_wait_begin(void)
+{
+	wait_start = stats_now_us();
+}
+
+/**
+ * @brief Call this once a reply (or error) has been received.
+ */
+void stats_wait_end(void)
+{
+	cur->replies++;
+	cur->wait_us += stats_now_us() - wait_start;
+}
+
+/**
+ * @brief Zero all of the counters.
+ *
+ * @ingroup commands
+ */
+void stats_reset(void)
+{
+	log_info("Resetting X request stats");
+	nr_buckets = 0;
+	memset(buckets, 0, sizeof(buckets));
+	memset(&other, 0, sizeof(other));
+	snprintf(other.name, STATS_NAME_LEN, "%s", "other");
+}
+
+/**
+ * @brief Print a line for each handler and command, followed by the totals.
+ *
+ * The format for each line is:
+ *
+ *	name calls requests replies wait_us
+ *
+ * @param f Where the stats should be printed.
+ */
+void stats_print(FILE *f)
+{
+	struct stats total = other;
+	unsigned int i;
+
+	snprintf(total.name, STATS_NAME_LEN, "%s", "total");
+	fprintf(f, "name calls requests replies wait_us\n");
+	for (i = 0; i < nr_buckets; i++) {
+		fprintf(f, "%s %lu %lu %lu %llu\n", buckets[i].name,
+			buckets[i].calls, buckets[i].requests,
+			buckets[i].replies,
+			(unsigned long long)buckets[i].wait_us);
+		total.calls += buckets[i].calls;
+		total.requests += buckets[i].requests;
+		total.replies += buckets[i].replies;
+		total.wait_us += buckets[i].wait_us;
+	}
+	fprintf(f, "%s %lu %lu %lu %llu\n", other.name, other.calls,
+		other.requests, other.replies,
+		(unsigned long long)other.wait_us);
+	fprintf(f, "%s %lu %lu %lu %llu\n", total.name, total.calls,
+		total.requests, total.replies,
+		(unsigned long long)total.wait_us);
+}
+
+/**
+ * @brief Find the latency that a given fraction of runs completed within.
+ *
+ * @param s The handler or command.
+ * @param permille The fraction of runs, in thousandths.
+ *
+ * @return The latency in microseconds.
+ */
+static uint64_t hist_percentile(const struct stats *s, unsigned int permille)
+{
+	uint64_t want = (s->calls * permille + 999) / 1000, seen = 0;
+	unsigned int i;
+
+	for (i = 0; i < STATS_HIST_SLOTS; i++) {
+		seen += s->hist[i];
+		if (seen >= want && seen > 0)
+			break;
+	}
+	if (i == STATS_HIST_SLOTS || hist_slot_max(i) > s->max_us)
+		return s->max_us;
+	return hist_slot_max(i);
+}
+
+/**
+ * @brief Print a line for each handler and command that has run.
+ *
+ * The format for each line is:
+ *
+ *	name calls mean_us p50_us p90_us p99_us p999_us max_us
+ *
+ * @param f Where the latencies should be printed.
+ */
+void stats_print_latency(FILE *f)
+{
+	const struct stats *s;
+	unsigned int i;
+
+	fprintf(f, "name calls mean_us p50_us p90_us p99_us p999_us max_us\n");
+	for (i = 0; i <= nr_buckets; i++) {
+		s = i < nr_buckets ? &buckets[i] : &other;
+		if (s->calls == 0)
+			continue;
+		fprintf(f, "%s %lu %llu %llu %llu %llu %llu %llu\n", s->name,
+			s->calls,
+			(unsigned long long)(s->total_us / s->calls),
+			(unsigned long long)hist_percentile(s, 500),
+			(unsigned long long)hist_percentile(s, 900),
+			(unsigned long long)hist_percentile(s, 990),
+			(unsigned long long)hist_percentile(s, 999),
+			(unsigned long long)s->max_us);
+	}
+}
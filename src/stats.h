@@ -0,0 +1,59 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @file stats.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The maximum length of a handler or command name, including the
+ * terminator. */
+#define STATS_NAME_LEN 32
+/** The amount of handlers and commands that are tracked separately. Anything
+ * beyond this is counted under "other". */
+#define STATS_MAX_BUCKETS 64
+/** Each power of two of latency is split into this many histogram slots,
+ * which keeps the error of any percentile below 1/8th. */
+#define STATS_HIST_SUB_BITS 3
+#define STATS_HIST_SUB (1 << STATS_HIST_SUB_BITS)
+/** Enough histogram slots to hold latencies of up to 2^32 microseconds. */
+#define STATS_HIST_SLOTS ((32 - STATS_HIST_SUB_BITS + 2) * STATS_HIST_SUB)
+
+/** Count an X request that is sent by howm. The request's cookie is passed
+ * through, so this can wrap any xcb call that sends a request. */
+#define XREQ(req) (stats_request(), (req))
+
+/**
+ * @brief The X traffic generated while running a handler or command.
+ */
+struct stats {
+	char name[STATS_NAME_LEN]; /**< The handler or command. */
+	unsigned long calls; /**< How many times it has run. */
+	unsigned long requests; /**< How many X requests it has sent. */
+	unsigned long replies; /**< How many replies it has blocked on. */
+	uint64_t wait_us; /**< Time spent blocked on replies, in
+			    microseconds. */
+	uint64_t total_us; /**< Time spent running, in microseconds. */
+	uint64_t max_us; /**< The longest single run, in microseconds. */
+	uint32_t hist[STATS_HIST_SLOTS]; /**< How long each run took. */
+};
+
+void stats_begin(const char *name);
+void stats_end(void);
+void stats_request(void);
+void stats_wait_begin(void);
+void stats_wait_end(void);
+void stats_reset(void);
+void stats_print(FILE *f);
+void stats_print_latency(FILE *f);
+uint64_t stats_now_us(void);
+
+#endif
@@ -0,0 +1,238 @@
+#define LOG_SUBSYS LOG_CLIENT
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+
+#include "backend.h"
+#include "client.h"
+#include "configure.h"
+#include "helper.h"
+#include "howm.h"
+#include "location.h"
+#include "monitor.h"
+#include "sticky.h"
+#include "types.h"
+#include "xcb_help.h"
+
+/**
+ * @file sticky.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Sticky clients, which are shown on every workspace of their monitor.
+ *
+ * A sticky client isn't in any workspace's client list. Instead, each monitor
+ * keeps a list of its sticky clients, which draw_clients() and
+ * update_focused_client() add to the floating clients and the stacking order
+ * of whichever workspace is shown. This means that changing workspace doesn't
+ * have to unmap, map or move a sticky client.
+ *
+ * As they aren't in a workspace, sticky clients can't be focused by motions.
+ * Clicking one (or entering it, with focus_mouse) gives it input focus until a
+ * workspace's client is focused again.
+ */
+
+/**
+ * @brief Find a sticky client by its window.
+ *
+ * Sticky clients aren't in any client list, so loc_win() won't find them.
+ *
+ * @param win The window to search for.
+ * @param r_mon Is set to the client's monitor, if it isn't NULL.
+ *
+ * @return The client, or NULL if win doesn't belong to a sticky client.
+ */
+client_t *sticky_find(xcb_window_t win, monitor_t **r_mon)
+{
+	monitor_t *m;
+	client_t *c;
+
+	for (m = mon_head; m; m = m->next)
+		for (c = m->sticky_head; c; c = c->next)
+			if (c->win == win) {
+				if (r_mon)
+					*r_mon = m;
+				return c;
+			}
+	return NULL;
+}
+
+/**
+ * @brief Take a client out of its monitor's sticky list.
+ *
+ * @param m The monitor that the client is stuck to.
+ * @param c The client.
+ *
+ * @return True if the client was found and unlinked.
+ */
+static bool unlink_sticky(monitor_t *m, client_t *c)
+{
+	client_t **pp;
+
+	for (pp = &m->sticky_head; *pp; pp = &(*pp)->next)
+		if (*pp == c) {
+			*pp = c->next;
+			c->next = NULL;
+			c->is_sticky = false;
+			if (m->sticky_c == c)
+				m->sticky_c = NULL;
+			return true;
+		}
+	return false;
+}
+
+/**
+ * @brief Move a client from its workspace to its monitor's sticky list, or
+ * back to the monitor's current workspace.
+ *
+ * A sticky client always floats, keeping the geometry that it had when it was
+ * stuck.
+ *
+ * @param c The client.
+ * @param sticky Whether the client should be sticky.
+ */
+void set_sticky(client_t *c, bool sticky)
+{
+	location_t loc;
+	monitor_t *m;
+
+	if (!c || c->is_sticky == sticky)
+		return;
+
+	if (!sticky) {
+		if (!sticky_find(c->win, &m) || !unlink_sticky(m, c))
+			return;
+		log_info("Unsticking client <%p>", c);
+		attach_client(m->ws, c);
+		if (m == mon)
+			update_focused_client(c);
+		return;
+	}
+
+	if (c->is_fullscreen) {
+		log_warn("Can't make fullscreen client <%p> sticky", c);
+		return;
+	}
+	if (!loc_client(&loc, c) || !detach_client(loc.mon, loc.ws, c))
+		return;
+	log_info("Sticking client <%p> to monitor <%d>", c,
+			monitor_to_index(loc.mon));
+	/* The client may have been hidden along with its workspace or by the
+	 * tabbed layout. */
+	if (loc.ws != loc.mon->ws || c->is_tab_hidden)
+		xb->map_window(c->win);
+	c->is_tab_hidden = false;
+	c->is_sticky = true;
+	c->is_floating = true;
+	c->is_stale = true;
+	c->next = loc.mon->sticky_head;
+	loc.mon->sticky_head = c;
+	queue_border_colour(c->win, conf.border_unfocus);
+
+	if (loc.mon != mon)
+		elevate_window(c->win);
+	else if (mon->ws->c)
+		update_focused_client(mon->ws->c);
+	else
+		draw_clients();
+}
+
+/**
+ * @brief Stick the focused client to the current monitor, or unstick the
+ * focused sticky client onto the current workspace.
+ *
+ * @ingroup commands
+ */
+void toggle_sticky(void)
+{
+	if (mon->sticky_c)
+		set_sticky(mon->sticky_c, false);
+	else
+		set_sticky(mon->ws->c, true);
+}
+
+/**
+ * @brief Give input focus to a sticky client.
+ *
+ * The workspace's focused client keeps its place, so that focusing any
+ * workspace client takes focus back from the sticky client.
+ *
+ * @param m The monitor that the client is stuck to.
+ * @param c The sticky client.
+ */
+void sticky_focus(monitor_t *m, client_t *c)
+{
+	if (m->sticky_c == c)
+		return;
+	if (m->sticky_c)
+		queue_border_colour(m->sticky_c->win, conf.border_unfocus);
+	else if (m->ws->c)
+		queue_border_colour(m->ws->c->win, conf.border_unfocus);
+	log_info("Focusing sticky client <%p>", c);
+	m->sticky_c = c;
+	queue_border_colour(c->win, conf.border_focus);
+	elevate_window(c->win);
+	xb->set_active_window(c->win);
+	xb->set_input_focus(c->win);
+}
+
+/**
+ * @brief Forget about a sticky client whose window has gone away.
+ *
+ * @param m The monitor that the client is stuck to.
+ * @param c The sticky client.
+ */
+void sticky_remove(monitor_t *m, client_t *c)
+{
+	bool had_focus = m->sticky_c == c;
+
+	if (!unlink_sticky(m, c))
+		return;
+	log_info("Removing sticky client <%p>", c);
+	free(c);
+	if (had_focus && m == mon) {
+		if (mon->ws->c)
+			update_focused_client(mon->ws->c);
+		else
+			focus_root();
+	}
+}
+
+/**
+ * @brief Close the sticky client that has focus on a monitor.
+ *
+ * The client is forgotten once its window is destroyed.
+ *
+ * @param m The monitor.
+ */
+void sticky_kill(monitor_t *m)
+{
+	client_t *c = m->sticky_c;
+
+	if (!c)
+		return;
+	log_info("Killing sticky client <%p>", c);
+	if (xb->supports_delete(c->win))
+		delete_win(c->win);
+	else
+		xb->kill_client(c->win);
+}
+
+/**
+ * @brief Move every sticky client on a monitor to its current workspace, for
+ * when the monitor is about to be removed.
+ *
+ * @param m The monitor.
+ */
+void sticky_release_all(monitor_t *m)
+{
+	client_t *c;
+
+	while ((c = m->sticky_head)) {
+		unlink_sticky(m, c);
+		attach_client(m->ws, c);
+	}
+}
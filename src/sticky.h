@@ -0,0 +1,27 @@
+#ifndef STICKY_H
+#define STICKY_H
+
+#include <stdbool.h>
+#include <xcb/xcb.h>
+
+#include "types.h"
+
+/**
+ * @file sticky.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+void set_sticky(client_t *c, bool sticky);
+void toggle_sticky(void);
+client_t *sticky_find(xcb_window_t win, monitor_t **r_mon);
+void sticky_focus(monitor_t *m, client_t *c);
+void sticky_remove(monitor_t *m, client_t *c);
+void sticky_kill(monitor_t *m);
+void sticky_release_all(monitor_t *m);
+
+#endif
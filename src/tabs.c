@@ -0,0 +1,281 @@
+#define LOG_SUBSYS LOG_LAYOUT
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+#include "backend.h"
+#include "client.h"
+#include "configure.h"
+#include "helper.h"
+#include "howm.h"
+#include "layout.h"
+#include "tabs.h"
+#include "types.h"
+
+/**
+ * @file tabs.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief The tab strip of the tabbed layout, and the bookkeeping for the
+ * clients that it hides.
+ *
+ * In the tabbed layout only the active tab's client is mapped. The others
+ * are unmapped (and marked with is_tab_hidden) until they are selected, so
+ * neither the X server nor a compositor has to keep them up to date. Each
+ * monitor has a single strip window, which howm draws itself with core
+ * requests. The titles are fetched when first drawn and refetched when a
+ * client changes them.
+ */
+
+/**
+ * @brief Find the tab that is shown on a workspace using the tabbed layout.
+ *
+ * @param ws The workspace.
+ *
+ * @return The focused client if it is tiled. Otherwise the tiled client that
+ * is already shown, or the first tiled client. NULL if there are no tiled
+ * clients.
+ */
+client_t *tab_active(const workspace_t *ws)
+{
+	client_t *c, *first = NULL;
+
+	if (ws->c && !FFT(ws->c))
+		return ws->c;
+	for (c = ws->head; c; c = c->next) {
+		if (FFT(c))
+			continue;
+		if (!c->is_tab_hidden)
+			return c;
+		if (!first)
+			first = c;
+	}
+	return first;
+}
+
+/**
+ * @brief Where the tab strip goes on a monitor, at the top of the space that
+ * clients are tiled in.
+ *
+ * @param m The monitor.
+ *
+ * @return The strip's geometry, which has no height if tabs are disabled.
+ */
+xcb_rectangle_t tabs_rect(const monitor_t *m)
+{
+	uint16_t h = m->rect.height - m->ws->bar_height;
+
+	return (xcb_rectangle_t) { m->rect.x, conf.bar_bottom ? m->rect.y
+		: m->rect.y + m->ws->bar_height, m->rect.width,
+		conf.tab_height < h ? conf.tab_height : 0 };
+}
+
+/**
+ * @brief Draw a tab for each tiled client on a monitor's workspace, creating
+ * and mapping the tab strip if needed.
+ *
+ * @param m The monitor.
+ */
+void tabs_draw(monitor_t *m)
+{
+	xcb_rectangle_t r = tabs_rect(m), tab;
+	client_t *c, *active = tab_active(m->ws);
+	int n = get_non_tff_count(m), i = 0;
+	uint32_t vals[4];
+
+	if (!n || !r.height) {
+		tabs_hide(m);
+		return;
+	}
+	if (!m->tab_win) {
+		m->tab_win = xb->create_window(r, conf.border_unfocus);
+		m->tab_rect = r;
+	} else if (r.x != m->tab_rect.x || r.y != m->tab_rect.y
+			|| r.width != m->tab_rect.width
+			|| r.height != m->tab_rect.height) {
+		vals[0] = r.x;
+		vals[1] = r.y;
+		vals[2] = r.width;
+		vals[3] = r.height;
+		queue_configure(m->tab_win, MOVE_RESIZE_MASK, vals);
+		m->tab_rect = r;
+	}
+	if (!m->tab_shown) {
+		configure_commit();
+		xb->map_window(m->tab_win);
+		m->tab_shown = true;
+	}
+
+	for (c = m->ws->head; c; c = c->next) {
+		if (FFT(c))
+			continue;
+		if (!c->has_title) {
+			xb->get_title(c->win, c->title, sizeof(c->title));
+			c->has_title = true;
+		}
+		tab.x = i * r.width / n;
+		tab.y = 0;
+		tab.width = (i + 1) * r.width / n - tab.x;
+		tab.height = r.height;
+		xb->draw_label(m->tab_win,
+			       c == active ? conf.border_unfocus : conf.border_focus,
+			       c == active ? conf.border_focus : conf.border_unfocus,
+			       tab, c->title);
+		i++;
+	}
+}
+
+/**
+ * @brief Unmap a monitor's tab strip.
+ *
+ * @param m The monitor.
+ */
+void tabs_hide(monitor_t *m)
+{
+	if (!m->tab_shown)
+		return;
+	xb->unmap_window(m->tab_win);
+	m->tab_shown = false;
+}
+
+/**
+ * @brief Map a client that the tabbed layout has hidden, once its geometry
+ * has been sent, so that it only draws itself once.
+ *
+ * @param c The client.
+ */
+void tabs_unhide(client_t *c)
+{
+	if (!c->is_tab_hidden)
+		return;
+	c->is_tab_hidden = false;
+	configure_commit();
+	xb->map_window(c->win);
+}
+
+/**
+ * @brief Map every client that the tabbed layout hid and remove the tab
+ * strip, for when a monitor's workspace stops using the tabbed layout. This
+ * should be called after the new layout has been drawn.
+ *
+ * @param m The monitor.
+ */
+void tabs_restore(monitor_t *m)
+{
+	client_t *c;
+
+	tabs_hide(m);
+	for (c = m->ws->head; c; c = c->next)
+		tabs_unhide(c);
+}
+
+/**
+ * @brief Find the monitor that a window is the tab strip of.
+ *
+ * @param win The window.
+ *
+ * @return The monitor, or NULL if win isn't a tab strip.
+ */
+static monitor_t *strip_to_monitor(xcb_window_t win)
+{
+	monitor_t *m;
+
+	for (m = mon_head; m; m = m->next)
+		if (m->tab_win && m->tab_win == win)
+			return m;
+	return NULL;
+}
+
+/**
+ * @brief Focus the client whose tab was clicked.
+ *
+ * @param be The button press.
+ *
+ * @return True if the press was on a tab strip.
+ */
+bool tabs_click(xcb_button_press_event_t *be)
+{
+	monitor_t *m = strip_to_monitor(be->event);
+	client_t *c;
+	int n, i;
+
+	if (!m)
+		return false;
+	n = get_non_tff_count(m);
+	if (m != mon || !n || be->detail != XCB_BUTTON_INDEX_1)
+		return true;
+	i = be->event_x * n / m->tab_rect.width;
+	for (c = m->ws->head; c; c = c->next)
+		if (!FFT(c) && i-- == 0)
+			break;
+	if (c && c != m->ws->c)
+		update_focused_client(c);
+	return true;
+}
+
+/**
+ * @brief Redraw a tab strip once the X server has finished exposing it.
+ *
+ * @param ee The expose event.
+ *
+ * @return True if the event was for a tab strip.
+ */
+bool tabs_expose(xcb_expose_event_t *ee)
+{
+	monitor_t *m = strip_to_monitor(ee->window);
+
+	if (!m)
+		return false;
+	if (ee->count == 0 && m->tab_shown)
+		tabs_draw(m);
+	return true;
+}
+
+/**
+ * @brief Forget a client's title, redrawing its tab if it can be seen.
+ *
+ * @param m The monitor that the client is on.
+ * @param ws The workspace that the client is on.
+ * @param c The client whose title changed.
+ */
+void tabs_title_changed(monitor_t *m, workspace_t *ws, client_t *c)
+{
+	c->has_title = false;
+	if (m->ws == ws && m->tab_shown && !FFT(c))
+		tabs_draw(m);
+}
+
+/**
+ * @brief Check whether any workspace uses the tabbed layout, in which case
+ * clients' titles need to be watched.
+ *
+ * @return True if a workspace uses the tabbed layout.
+ */
+bool tabs_in_use(void)
+{
+	monitor_t *m;
+	workspace_t *ws;
+
+	for (m = mon_head; m; m = m->next)
+		for (ws = m->ws_head; ws; ws = ws->next)
+			if (ws->layout == TABBED)
+				return true;
+	return false;
+}
+
+/**
+ * @brief Destroy a monitor's tab strip.
+ *
+ * @param m The monitor that is being removed.
+ */
+void tabs_free(monitor_t *m)
+{
+	if (m->tab_win)
+		xb->destroy_window(m->tab_win);
+	m->tab_win = XCB_NONE;
+	m->tab_shown = false;
+}
@@ -0,0 +1,31 @@
+#ifndef TABS_H
+#define TABS_H
+
+#include <stdbool.h>
+#include <xcb/xcb.h>
+
+#include "types.h"
+
+/**
+ * @file tabs.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+client_t *tab_active(const workspace_t *ws);
+xcb_rectangle_t tabs_rect(const monitor_t *m);
+void tabs_draw(monitor_t *m);
+void tabs_hide(monitor_t *m);
+void tabs_unhide(client_t *c);
+void tabs_restore(monitor_t *m);
+bool tabs_click(xcb_button_press_event_t *be);
+bool tabs_expose(xcb_expose_event_t *ee);
+void tabs_title_changed(monitor_t *m, workspace_t *ws, client_t *c);
+bool tabs_in_use(void);
+void tabs_free(monitor_t *m);
+
+#endif
@@ -0,0 +1,158 @@
+#define _POSIX_C_SOURCE 200809L
+#define LOG_SUBSYS LOG_CORE
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "helper.h"
+#include "stats.h"
+#include "trace.h"
+
+/**
+ * @file trace.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief A fixed size ring buffer that records what howm is doing.
+ *
+ * Recording is cheap: a timestamp and some raw integers are copied into the
+ * next slot, overwriting the oldest record. Nothing is formatted until the
+ * buffer is dumped, either by the trace query or by sending howm SIGUSR1.
+ */
+
+/** How each record is printed. */
+struct trace_fmt {
+	const char *name; /**< The name of the record. */
+	const char *fmt; /**< A format that is passed every argument, as an
+			   unsigned long long. */
+	bool str; /**< The first four arguments hold a string, only the last
+		    is passed to fmt. */
+};
+
+static const struct trace_fmt trace_fmt[TR_MAX] = {
+	[TR_EVENT] = { "event", " seq=%llu", true },
+	[TR_IPC] = { "ipc", " type=%llu", true },
+	[TR_BUTTON] = { "button", "button=%llu x=%lld y=%lld", false },
+	[TR_MAP] = { "map", "win=0x%llx", false },
+	[TR_MAP_GEOM] = { "map_geom", "win=0x%llx geom=%llux%llu+%lld+%lld", false },
+	[TR_DESTROY] = { "destroy", "client=0x%llx", false },
+	[TR_ENTER] = { "enter", "win=0x%llx", false },
+	[TR_CONFIGURE] = { "configure", "win=0x%llx geom=%llux%llu+%lld+%lld", false },
+	[TR_UNMAP] = { "unmap", "client=0x%llx", false },
+	[TR_CLIENT_MSG] = { "client_msg", "win=0x%llx type=%llu", false },
+	[TR_FOCUS] = { "focus", "client=0x%llx win=0x%llx", false },
+	[TR_ELEVATE] = { "elevate", "win=0x%llx", false },
+	[TR_DRAW] = { "draw", "ws=%llu clients=%llu", false },
+	[TR_GEOM] = { "geom", "client=0x%llx geom=%llux%llu+%lld+%lld", false },
+	[TR_ARRANGE] = { "arrange", "monitor=%llu layout=%llu clients=%llu", false },
+	[TR_CHANGE_WS] = { "change_ws", "from=%llu to=%llu", false },
+	[TR_KEY] = { "key", " sym=0x%llx", true },
+	[TR_SPAWN] = { "spawn", "pid=%llu", false },
+	[TR_EXIT] = { "exit", "pid=%llu status=%llu", false },
+	[TR_DRAG] = { "drag", "win=0x%llx resize=%llu", false },
+};
+
+static struct trace_rec trace_buf[TRACE_LEN];
+/** The total amount of records ever made, the next record is stored at
+ * trace_head % TRACE_LEN. */
+static uint64_t trace_head;
+
+/** Set when SIGUSR1 is received, the main loop then dumps the trace. */
+volatile sig_atomic_t trace_dump_pending;
+
+static void trace_signal(int sig)
+{
+	UNUSED(sig);
+	trace_dump_pending = 1;
+}
+
+/**
+ * @brief Ask for the trace to be dumped to stderr when SIGUSR1 is received.
+ *
+ * The handler only sets a flag, the dump happens in the main loop.
+ */
+void trace_init(void)
+{
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = trace_signal;
+	sigemptyset(&sa.sa_mask);
+	/* No SA_RESTART, so that select() is interrupted. */
+	if (sigaction(SIGUSR1, &sa, NULL) == -1)
+		log_err("Couldn't install the SIGUSR1 handler");
+}
+
+/**
+ * @brief Make a record in the trace buffer. Use TRACE() rather than calling
+ * this directly.
+ *
+ * @param id What is being recorded.
+ * @param args TRACE_NR_ARGS raw arguments.
+ */
+void trace_add(enum trace_id id, const uint64_t *args)
+{
+	struct trace_rec *r = &trace_buf[trace_head++ & (TRACE_LEN - 1)];
+
+	r->us = stats_now_us();
+	r->id = id;
+	memcpy(r->args, args, sizeof(r->args));
+}
+
+/**
+ * @brief Make a record that contains a string, such as the name of an IPC
+ * command. The string is truncated if it doesn't fit.
+ *
+ * @param id What is being recorded.
+ * @param str The string to copy into the record.
+ * @param arg An integer to store after the string.
+ */
+void trace_str(enum trace_id id, const char *str, uint64_t arg)
+{
+	struct trace_rec *r = &trace_buf[trace_head++ & (TRACE_LEN - 1)];
+
+	r->us = stats_now_us();
+	r->id = id;
+	strncpy((char *)r->args, str ? str : "", sizeof(r->args) - sizeof(arg));
+	r->args[TRACE_NR_ARGS - 1] = arg;
+}
+
+/**
+ * @brief Print the trace buffer, oldest record first.
+ *
+ * Each line is of the form:
+ *
+ *	us name args
+ *
+ * @param f Where the records should be printed.
+ */
+void trace_dump(FILE *f)
+{
+	uint64_t i = trace_head > TRACE_LEN ? trace_head - TRACE_LEN : 0;
+	const struct trace_rec *r;
+	const struct trace_fmt *tf;
+
+	for (; i < trace_head; i++) {
+		r = &trace_buf[i & (TRACE_LEN - 1)];
+		tf = &trace_fmt[r->id];
+		fprintf(f, "%llu %s ", (unsigned long long)r->us, tf->name);
+		if (tf->str) {
+			fprintf(f, "%.*s", (int)(sizeof(r->args) - sizeof(*r->args)),
+				(const char *)r->args);
+			fprintf(f, tf->fmt,
+				(unsigned long long)r->args[TRACE_NR_ARGS - 1]);
+		} else {
+			fprintf(f, tf->fmt,
+				(unsigned long long)r->args[0],
+				(unsigned long long)r->args[1],
+				(unsigned long long)r->args[2],
+				(unsigned long long)r->args[3],
+				(unsigned long long)r->args[4]);
+		}
+		fputc('\n', f);
+	}
+}
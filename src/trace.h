@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @file trace.h
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief howm
+ */
+
+/** The amount of records kept, this must be a power of two. */
+#define TRACE_LEN 4096
+/** The amount of raw arguments stored with each record. */
+#define TRACE_NR_ARGS 5
+
+/** Record an event in the trace buffer. Up to TRACE_NR_ARGS integer arguments
+ * can be given, pointers must be cast to uintptr_t first. */
+#define TRACE(id, ...) \
+	trace_add(id, (const uint64_t[TRACE_NR_ARGS]) { __VA_ARGS__ })
+
+/** The things that can be recorded. Keep in sync with trace_fmt in trace.c. */
+enum trace_id {
+	TR_EVENT,
+	TR_IPC,
+	TR_BUTTON,
+	TR_MAP,
+	TR_MAP_GEOM,
+	TR_DESTROY,
+	TR_ENTER,
+	TR_CONFIGURE,
+	TR_UNMAP,
+	TR_CLIENT_MSG,
+	TR_FOCUS,
+	TR_ELEVATE,
+	TR_DRAW,
+	TR_GEOM,
+	TR_ARRANGE,
+	TR_CHANGE_WS,
+	TR_KEY,
+	TR_SPAWN,
+	TR_EXIT,
+	TR_DRAG,
+	TR_MAX
+};
+
+/**
+ * @brief A single entry in the trace buffer.
+ */
+struct trace_rec {
+	uint64_t us; /**< When the record was made, in microseconds. */
+	uint64_t id; /**< What was recorded, one of enum trace_id. */
+	uint64_t args[TRACE_NR_ARGS]; /**< Raw arguments, only interpreted when
+					the buffer is dumped. */
+};
+
+extern volatile sig_atomic_t trace_dump_pending;
+
+void trace_init(void);
+void trace_add(enum trace_id id, const uint64_t *args);
+void trace_str(enum trace_id id, const char *str, uint64_t arg);
+void trace_dump(FILE *f);
+
+#endif
@@ -16,6 +16,9 @@
  * @brief howm
  */
 
+/** The longest title shown on a tab, including the terminator. */
+#define CLIENT_TITLE_LEN 64
+
 /**
  * @brief Represents a client that is being handled by howm.
  *
@@ -34,6 +37,15 @@ struct client_t {
 	xcb_rectangle_t rect; /**< The size and location of the client. */
 	uint16_t gap; /**< The size of the useless gap between this client and
 			the others. */
+	bool is_stale; /**< The window hasn't been configured since its rect or
+			gap last changed. */
+	bool is_tab_hidden; /**< The window has been unmapped by the tabbed
+			layout, as it isn't the active tab. */
+	bool has_title; /**< title has been fetched and is up to date. */
+	char title[CLIENT_TITLE_LEN]; /**< The window's title, for its tab. */
+	bool is_sticky; /**< The client is shown on every workspace of its
+			monitor, so it is in the monitor's sticky list rather
+			than a workspace's. */
 };
 
 /**
@@ -80,6 +92,14 @@ struct monitor_t {
 	monitor_t *prev; /**< The previous monitor. */
 	xcb_rectangle_t rect; /**< The size and location of the monitor. */
 	xcb_randr_output_t output; /**< The ID of the randr output. */
+	xcb_window_t tab_win; /**< The tab strip of the tabbed layout, or
+			       XCB_NONE if it hasn't been created. */
+	xcb_rectangle_t tab_rect; /**< Where tab_win is. */
+	bool tab_shown; /**< Whether tab_win is mapped. */
+	client_t *sticky_head; /**< The clients that are shown on every
+				workspace, they always float. */
+	client_t *sticky_c; /**< The sticky client that has input focus, or
+			     NULL if a workspace's client has it. */
 };
 
 typedef struct {
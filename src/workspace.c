@@ -1,10 +1,16 @@
+#define LOG_SUBSYS LOG_CLIENT
+
 #include <xcb/xcb_ewmh.h>
 #include <xcb/xproto.h>
 
+#include "backend.h"
 #include "client.h"
 #include "helper.h"
 #include "howm.h"
+#include "layout.h"
 #include "monitor.h"
+#include "tabs.h"
+#include "trace.h"
 #include "types.h"
 #include "workspace.h"
 #include "xcb_help.h"
@@ -31,8 +37,7 @@ void kill_ws(monitor_t *m, workspace_t *ws)
 	if (!ws || !ws->client_cnt)
 		return;
 
-	while (ws->head)
-		kill_client(m, ws, m->ws->head);
+	kill_clients(m, ws, ws->head, ws->client_cnt);
 
 	log_info("Killed off workspace <%d>", workspace_to_index(ws));
 }
@@ -80,8 +85,8 @@ inline workspace_t *offset_ws(workspace_t *ws, int offset)
 	bool pos = offset > 0 ? true : false;
 
 	offset = abs(offset);
-	for (; ows != NULL && offset > 0; ows = pos ? ws->next
-					: ws->prev, offset--)
+	for (; ows != NULL && offset > 0; ows = pos ? ows->next
+					: ows->prev, offset--)
 		;
 
 	return ows;
@@ -135,22 +140,26 @@ void change_ws(const workspace_t *ws)
 	client_t *c = ws->head;
 
 	mon->last_ws = mon->ws;
-	log_debug("Changing from workspace <%d> to <%d>.", workspace_to_index(mon->last_ws),
-							workspace_to_index(ws));
+	TRACE(TR_CHANGE_WS, workspace_to_index(mon->last_ws), workspace_to_index(ws));
 
+	/* Clients hidden by the tabbed layout stay unmapped. */
 	for (; c; c = c->next)
-		xcb_map_window(dpy, c->win);
+		if (!c->is_tab_hidden)
+			xb->map_window(c->win);
 	for (c = mon->last_ws->head; c; c = c->next)
-		xcb_unmap_window(dpy, c->win);
+		if (!c->is_tab_hidden)
+			xb->unmap_window(c->win);
+	if (ws->layout != TABBED || !ws->head)
+		tabs_hide(mon);
 
 	mon->ws = ws;
 
 	update_focused_client(mon->ws->c);
 
-	xcb_ewmh_set_current_desktop(ewmh, 0, workspace_to_index(ws));
+	xb->set_current_desktop(workspace_to_index(ws));
 	xcb_ewmh_geometry_t workarea[] = { { 0, conf.bar_bottom ? 0 : ws->bar_height,
 				mon->rect.width, mon->rect.height - ws->bar_height } };
-	xcb_ewmh_set_workarea(ewmh, 0, LENGTH(workarea), workarea);
+	xb->set_workarea(LENGTH(workarea), workarea);
 
 	howm_info();
 }
@@ -225,7 +234,7 @@ void add_ws(monitor_t *m)
 			monitor_to_index(m));
 
 	m->workspace_cnt++;
-	xcb_ewmh_set_number_of_desktops(ewmh, 0, m->workspace_cnt);
+	xb->set_number_of_desktops(m->workspace_cnt);
 }
 
 /**
@@ -262,7 +271,7 @@ void remove_ws(monitor_t *m, workspace_t *ws)
 
 	m->workspace_cnt--;
 	ewmh_set_current_workspace();
-	xcb_ewmh_set_number_of_desktops(ewmh, 0, m->workspace_cnt);
+	xb->set_number_of_desktops(m->workspace_cnt);
 
 	free(ws);
 }
@@ -1,13 +1,21 @@
+#define LOG_SUBSYS LOG_CORE
+
 #include <stdlib.h>
 #include <string.h>
 #include <xcb/randr.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_ewmh.h>
 
+#include "backend.h"
 #include "client.h"
+#include "configure.h"
 #include "helper.h"
 #include "howm.h"
 #include "location.h"
+#include "stats.h"
+#include "sticky.h"
+#include "tabs.h"
+#include "trace.h"
 #include "workspace.h"
 #include "xcb_help.h"
 
@@ -22,6 +30,101 @@
  * could be conditionally included if we decide to use wayland as well.
  */
 
+/** The event mask that clients currently have selected. */
+static uint32_t selected_mask;
+/** Whether clients currently have button 1 grabbed. */
+static bool buttons_grabbed;
+
+/**
+ * @brief The crossing events that are needed by the features that are
+ * enabled.
+ *
+ * Crossings focus windows when focus_mouse is set and, when there are
+ * several monitors, focus the monitor that the pointer moved to.
+ *
+ * @return An event mask.
+ */
+static uint32_t crossing_event_mask(void)
+{
+	if (conf.focus_mouse || (mon_head && mon_head->next))
+		return XCB_EVENT_MASK_ENTER_WINDOW;
+	return XCB_EVENT_MASK_NO_EVENT;
+}
+
+/**
+ * @brief The events that are needed from each client by the features that
+ * are enabled.
+ *
+ * As well as crossings, clients' titles are watched while a workspace uses
+ * the tabbed layout.
+ *
+ * @return An event mask.
+ */
+uint32_t client_event_mask(void)
+{
+	return crossing_event_mask()
+		| (tabs_in_use() ? XCB_EVENT_MASK_PROPERTY_CHANGE : 0);
+}
+
+/**
+ * @brief The events that are needed from the root window. Redirection is
+ * always needed, crossings only when clients need them too.
+ *
+ * @return An event mask.
+ */
+static uint32_t root_event_mask(void)
+{
+	return XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT
+		| XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY
+		| crossing_event_mask();
+}
+
+/**
+ * @brief Bring a client's event mask and button grab up to date.
+ *
+ * @param c The client.
+ * @param mask The event mask that clients should have selected.
+ * @param regrab Whether the client's buttons need to be grabbed again.
+ */
+static void select_client_events(client_t *c, uint32_t mask, bool regrab)
+{
+	if (mask != selected_mask)
+		xb->change_window_attributes(c->win, XCB_CW_EVENT_MASK, &mask);
+	if (regrab)
+		grab_buttons(c);
+}
+
+/**
+ * @brief Select the events needed by the enabled features on the root window
+ * and every client, and grab or release their buttons. This should be called
+ * whenever focus_mouse or focus_mouse_click change, or a workspace starts or
+ * stops using the tabbed layout. Nothing is sent if the masks and grabs are
+ * already correct.
+ */
+void select_events(void)
+{
+	uint32_t mask = client_event_mask(), root_mask = root_event_mask();
+	bool regrab = buttons_grabbed != conf.focus_mouse_click;
+	monitor_t *m;
+	workspace_t *ws;
+	client_t *c;
+
+	if (mask == selected_mask && !regrab)
+		return;
+	if (mask != selected_mask)
+		xb->change_window_attributes(screen->root, XCB_CW_EVENT_MASK,
+				&root_mask);
+	for (m = mon_head; m; m = m->next) {
+		for (ws = m->ws_head; ws; ws = ws->next)
+			for (c = ws->head; c; c = c->next)
+				select_client_events(c, mask, regrab);
+		for (c = m->sticky_head; c; c = c->next)
+			select_client_events(c, mask, regrab);
+	}
+	selected_mask = mask;
+	buttons_grabbed = conf.focus_mouse_click;
+}
+
 /**
  * @brief Try to detect if another WM exists.
  *
@@ -31,21 +134,20 @@
 void check_other_wm(void)
 {
 	xcb_generic_error_t *e;
-	uint32_t values[1] = { XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT |
-			       XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY |
-			       XCB_EVENT_MASK_BUTTON_PRESS |
-			       XCB_EVENT_MASK_ENTER_WINDOW |
-			       XCB_EVENT_MASK_PROPERTY_CHANGE
-			     };
-
-	e = xcb_request_check(dpy, xcb_change_window_attributes_checked(dpy,
-			      screen->root, XCB_CW_EVENT_MASK, values));
+	uint32_t values[1] = { root_event_mask() };
+
+	stats_wait_begin();
+	e = xcb_request_check(dpy, XREQ(xcb_change_window_attributes_checked(dpy,
+				   screen->root, XCB_CW_EVENT_MASK, values)));
+	stats_wait_end();
 	if (e != NULL) {
 		xcb_disconnect(dpy);
 		log_err("Couldn't register as WM. Perhaps another WM is running? XCB returned error_code: %d", e->error_code);
 		exit(EXIT_FAILURE);
 	}
 	free(e);
+	selected_mask = client_event_mask();
+	buttons_grabbed = conf.focus_mouse_click;
 }
 
 /**
@@ -62,7 +164,7 @@ void move_resize(xcb_window_t win,
 {
 	uint32_t position[] = { x, y, w, h };
 
-	xcb_configure_window(dpy, win, MOVE_RESIZE_MASK, position);
+	queue_configure(win, MOVE_RESIZE_MASK, position);
 }
 
 /**
@@ -72,11 +174,11 @@ void move_resize(xcb_window_t win,
  */
 void grab_buttons(client_t *c)
 {
-	xcb_ungrab_button(dpy, XCB_BUTTON_INDEX_ANY, c->win, XCB_GRAB_ANY);
-	xcb_grab_button(dpy, 1, c->win, XCB_EVENT_MASK_BUTTON_PRESS,
-			XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC,
-			XCB_WINDOW_NONE, XCB_CURSOR_NONE,
-			XCB_BUTTON_INDEX_ANY, XCB_BUTTON_MASK_ANY);
+	xb->ungrab_button(c->win);
+	/* Clicks are only needed to focus, so are otherwise left alone rather
+	 * than freezing the pointer on every press. */
+	if (conf.focus_mouse_click)
+		xb->grab_button(c->win, XCB_GRAB_MODE_SYNC);
 }
 
 /**
@@ -89,7 +191,7 @@ void set_border_width(xcb_window_t win, uint16_t w)
 {
 	uint32_t width[1] = { w };
 
-	xcb_configure_window(dpy, win, XCB_CONFIG_WINDOW_BORDER_WIDTH, width);
+	queue_configure(win, XCB_CONFIG_WINDOW_BORDER_WIDTH, width);
 }
 
 /**
@@ -101,8 +203,8 @@ void elevate_window(xcb_window_t win)
 {
 	uint32_t stack_mode[1] = { XCB_STACK_MODE_ABOVE };
 
-	log_info("Moving window <0x%x> to the front", win);
-	xcb_configure_window(dpy, win, XCB_CONFIG_WINDOW_STACK_MODE, stack_mode);
+	TRACE(TR_ELEVATE, win);
+	queue_configure(win, XCB_CONFIG_WINDOW_STACK_MODE, stack_mode);
 }
 
 /**
@@ -110,19 +212,22 @@ void elevate_window(xcb_window_t win)
  *
  * @param names The names of the atoms to be fetched.
  * @param atoms Where the returned atoms will be stored.
+ * @param cnt The amount of atoms to be fetched.
  */
-void get_atoms(const char **names, xcb_atom_t *atoms)
+void get_atoms(const char **names, xcb_atom_t *atoms, unsigned int cnt)
 {
 	xcb_intern_atom_reply_t *reply;
 	unsigned int i = 0;
-	xcb_intern_atom_cookie_t cookies[LENGTH(*names)];
+	xcb_intern_atom_cookie_t cookies[cnt];
 
-	for (i = 0; i < LENGTH(atoms); i++) {
-		cookies[i] = xcb_intern_atom(dpy, 0, strlen(names[i]), names[i]);
+	for (i = 0; i < cnt; i++) {
+		cookies[i] = XREQ(xcb_intern_atom(dpy, 0, strlen(names[i]), names[i]));
 		log_debug("Requesting atom %s", names[i]);
 	}
-	for (i = 0; i < LENGTH(atoms); i++) {
+	for (i = 0; i < cnt; i++) {
+		stats_wait_begin();
 		reply = xcb_intern_atom_reply(dpy, cookies[i], NULL);
+		stats_wait_end();
 		if (reply) {
 			atoms[i] = reply->atom;
 			log_debug("Got reply for atom %s", names[i]);
@@ -141,13 +246,28 @@ void get_atoms(const char **names, xcb_atom_t *atoms)
 void focus_window(xcb_window_t win)
 {
 	location_t loc;
-
-	if (loc_win(&loc, win) && loc.c != mon->ws->c)
-		update_focused_client(loc.c);
-	else
+	monitor_t *m;
+	client_t *c;
+
+	if (loc_win(&loc, win)) {
+		if (loc.c != mon->ws->c || mon->sticky_c)
+			update_focused_client(loc.c);
+	} else if ((c = sticky_find(win, &m))) {
+		sticky_focus(m, c);
+	} else if (win != screen->root) {
 		/* We don't want warnings for clicking the root window... */
-		if (win != screen->root)
-			log_warn("No client owns the window <0x%x>", win);
+		log_warn("No client owns the window <0x%x>", win);
+	}
+}
+
+/**
+ * @brief Give input focus to the root window, for when there is no client
+ * left to focus.
+ */
+void focus_root(void)
+{
+	xb->set_active_window(XCB_NONE);
+	xb->set_input_focus(screen->root);
 }
 
 /**
@@ -167,7 +287,7 @@ void delete_win(xcb_window_t win)
 	ev.type = wm_atoms[WM_PROTOCOLS];
 	ev.data.data32[0] = wm_atoms[WM_DELETE_WINDOW];
 	ev.data.data32[1] = XCB_CURRENT_TIME;
-	xcb_send_event(dpy, 0, win, XCB_EVENT_MASK_NO_EVENT, (char *)&ev);
+	xb->send_event(win, &ev);
 }
 
 /**
@@ -188,6 +308,13 @@ void ewmh_process_wm_state(client_t *c, xcb_atom_t a, int action)
 			set_fullscreen(c, true);
 		else if (action == XCB_EWMH_WM_STATE_TOGGLE)
 			set_fullscreen(c, !c->is_fullscreen);
+	} else if (a == ewmh->_NET_WM_STATE_STICKY) {
+		if (action == XCB_EWMH_WM_STATE_REMOVE)
+			set_sticky(c, false);
+		else if (action == XCB_EWMH_WM_STATE_ADD)
+			set_sticky(c, true);
+		else if (action == XCB_EWMH_WM_STATE_TOGGLE)
+			set_sticky(c, !c->is_sticky);
 	} else if (a == ewmh->_NET_WM_STATE_DEMANDS_ATTENTION) {
 		if (action == XCB_EWMH_WM_STATE_REMOVE)
 			set_urgent(c, false);
@@ -211,8 +338,10 @@ void setup_ewmh(void)
 		log_err("Unable to create ewmh connection\n");
 		exit(EXIT_FAILURE);
 	}
+	stats_wait_begin();
 	if (xcb_ewmh_init_atoms_replies(ewmh, xcb_ewmh_init_atoms(dpy, ewmh), NULL) == 0)
 		log_err("Couldn't initialise ewmh atoms");
+	stats_wait_end();
 	xcb_atom_t ewmh_net_atoms[] = { ewmh->_NET_SUPPORTED,
 					ewmh->_NET_SUPPORTING_WM_CHECK,
 					ewmh->_NET_DESKTOP_VIEWPORT,
@@ -220,14 +349,16 @@ void setup_ewmh(void)
 					ewmh->_NET_WM_STATE,
 					ewmh->_NET_CLOSE_WINDOW,
 					ewmh->_NET_WM_STATE_FULLSCREEN,
+					ewmh->_NET_WM_STATE_STICKY,
 					ewmh->_NET_CURRENT_DESKTOP,
 					ewmh->_NET_NUMBER_OF_DESKTOPS,
 					ewmh->_NET_DESKTOP_GEOMETRY,
 					ewmh->_NET_WORKAREA,
-					ewmh->_NET_ACTIVE_WINDOW };
-	xcb_ewmh_set_supported(ewmh, 0, LENGTH(ewmh_net_atoms), ewmh_net_atoms);
-	xcb_ewmh_set_supporting_wm_check(ewmh, 0, screen->root);
-	xcb_ewmh_set_wm_name(ewmh, 0, strlen("howm"), "howm");
+					ewmh->_NET_ACTIVE_WINDOW,
+					wm_atoms[NET_WM_BYPASS_COMPOSITOR] };
+	XREQ(xcb_ewmh_set_supported(ewmh, 0, LENGTH(ewmh_net_atoms), ewmh_net_atoms));
+	XREQ(xcb_ewmh_set_supporting_wm_check(ewmh, 0, screen->root));
+	XREQ(xcb_ewmh_set_wm_name(ewmh, 0, strlen("howm"), "howm"));
 }
 
 void setup_ewmh_geom(void)
@@ -237,14 +368,14 @@ void setup_ewmh_geom(void)
 						: mon->ws->bar_height, mon->rect.width,
 						mon->rect.height - mon->ws->bar_height} };
 
-	xcb_ewmh_set_desktop_viewport(ewmh, 0, LENGTH(viewport), viewport);
-	xcb_ewmh_set_workarea(ewmh, 0, LENGTH(workarea), workarea);
-	xcb_ewmh_set_desktop_geometry(ewmh, 0, mon->rect.width, mon->rect.height);
+	XREQ(xcb_ewmh_set_desktop_viewport(ewmh, 0, LENGTH(viewport), viewport));
+	xb->set_workarea(LENGTH(workarea), workarea);
+	XREQ(xcb_ewmh_set_desktop_geometry(ewmh, 0, mon->rect.width, mon->rect.height));
 }
 
 void ewmh_set_current_workspace(void)
 {
-	xcb_ewmh_set_current_desktop(ewmh, 0, workspace_to_index(mon->ws));
+	xb->set_current_desktop(workspace_to_index(mon->ws));
 }
 
 xcb_randr_output_t *randr_get_outputs(unsigned int *nr_outputs)
@@ -258,8 +389,10 @@ xcb_randr_output_t *randr_get_outputs(unsigned int *nr_outputs)
 	if (!qer || !qer->present)
 		return false;
 
-	sresc = xcb_randr_get_screen_resources(dpy, screen->root);
+	sresc = XREQ(xcb_randr_get_screen_resources(dpy, screen->root));
+	stats_wait_begin();
 	sresr = xcb_randr_get_screen_resources_reply(dpy, sresc, NULL);
+	stats_wait_end();
 	*nr_outputs = xcb_randr_get_screen_resources_outputs_length(sresr);
 
 	if (!sresr || *nr_outputs < 1)
@@ -283,8 +416,10 @@ xcb_rectangle_t output_reply_to_rect(xcb_randr_get_output_info_reply_t *output)
 	if (!output || output->crtc == XCB_NONE)
 		return rect;
 
-	cinfoc = xcb_randr_get_crtc_info(dpy, output->crtc, XCB_CURRENT_TIME);
+	cinfoc = XREQ(xcb_randr_get_crtc_info(dpy, output->crtc, XCB_CURRENT_TIME));
+	stats_wait_begin();
 	cinfor = xcb_randr_get_crtc_info_reply(dpy, cinfoc, NULL);
+	stats_wait_end();
 
 	if (cinfor)
 		rect = (xcb_rectangle_t){cinfor->x, cinfor->y,
@@ -300,8 +435,10 @@ xcb_randr_output_t randr_get_primary_output(void)
 	xcb_randr_get_output_primary_reply_t *gopr;
 	xcb_randr_output_t out;
 
-	gopc = xcb_randr_get_output_primary(dpy, screen->root);
+	gopc = XREQ(xcb_randr_get_output_primary(dpy, screen->root));
+	stats_wait_begin();
 	gopr = xcb_randr_get_output_primary_reply(dpy, gopc, NULL);
+	stats_wait_end();
 
 	if (gopr)
 		out = gopr->output;
@@ -314,7 +451,7 @@ xcb_randr_output_t randr_get_primary_output(void)
 
 void warp_pointer(int16_t x, int16_t y)
 {
-	xcb_warp_pointer(dpy, XCB_NONE, screen->root, 0, 0, 0, 0, x, y);
+	xb->warp_pointer(x, y);
 }
 
 void center_pointer(xcb_rectangle_t rect)
@@ -0,0 +1,405 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "client.h"
+#include "configure.h"
+#include "handler.h"
+#include "helper.h"
+#include "howm.h"
+#include "ipc.h"
+#include "layout.h"
+#include "op.h"
+#include "scratchpad.h"
+#include "types.h"
+#include "workspace.h"
+
+/**
+ * @file mock_test.c
+ *
+ * @author Harvey Hunt
+ *
+ * @date 2016
+ *
+ * @brief Regression tests, run against the mock backend so that no X server
+ * is needed.
+ *
+ * Each test runs in its own process, so that it starts with a fresh howm
+ * holding a single monitor and workspace. A test fails by exiting, which
+ * CHECK() does as soon as a condition doesn't hold.
+ *
+ * Usage: mock_test [NAME...]
+ */
+
+/** The window ID of the first fake client. */
+#define WIN_BASE 0x400000
+
+/** Fail the current test if cond is false. */
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", \
+					__FILE__, __LINE__, #cond); \
+			exit(EXIT_FAILURE); \
+		} \
+	} while (0)
+
+struct test {
+	const char *name;
+	void (*fn)(void);
+};
+
+/**
+ * @brief Add clients to the current workspace and focus the first of them.
+ *
+ * @param n The amount of clients to add.
+ */
+static void add_clients(unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		create_client(WIN_BASE + i);
+	update_focused_client(mon->ws->head);
+	configure_commit();
+	mock_reset();
+}
+
+/**
+ * @brief Check that a workspace's client list holds as many clients as its
+ * client_cnt says.
+ *
+ * @param ws The workspace.
+ *
+ * @return The length of the list.
+ */
+static unsigned int list_len(const workspace_t *ws)
+{
+	unsigned int n = 0;
+	client_t *c;
+
+	for (c = ws->head; c; c = c->next)
+		n++;
+	CHECK(n == ws->client_cnt);
+	return n;
+}
+
+/* A full delete register gives its bottom run back to a workspace that only
+ * holds one client. */
+static void test_evict_push_one_client(void)
+{
+	add_clients(3);
+	stack_resize(&del_reg, 1);
+	op_cut(CLIENT, 1);
+	op_cut(CLIENT, 1);
+	CHECK(list_len(mon->ws) == 2);
+	CHECK(del_reg.size == 1);
+}
+
+/* Shrinking the delete register gives runs back to a workspace that only
+ * holds one client. */
+static void test_evict_resize_one_client(void)
+{
+	add_clients(3);
+	op_cut(CLIENT, 1);
+	op_cut(CLIENT, 1);
+	CHECK(list_len(mon->ws) == 1);
+	stack_resize(&del_reg, 1);
+	CHECK(list_len(mon->ws) == 2);
+	CHECK(del_reg.size == 1);
+}
+
+/* A workspace cut takes the clients of the following workspaces, even when
+ * the current one is empty. */
+static void test_cut_ws_from_empty(void)
+{
+	workspace_t *next;
+
+	add_ws(mon);
+	next = mon->ws->next;
+	change_ws(next);
+	add_clients(2);
+	change_ws(mon->ws_head);
+	op_cut(WORKSPACE, 2);
+	CHECK(list_len(next) == 0);
+	CHECK(del_reg.size == 1);
+}
+
+/**
+ * @brief Send howm a crossing into a window.
+ *
+ * @param win The window that the pointer entered.
+ * @param x Where the pointer is, relative to the root window.
+ * @param full_sequence The last request that the X server had processed.
+ */
+static void enter_window(xcb_window_t win, int16_t x, uint32_t full_sequence)
+{
+	union {
+		xcb_generic_event_t generic;
+		xcb_enter_notify_event_t enter;
+	} ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.enter.response_type = XCB_ENTER_NOTIFY;
+	ev.enter.event = win;
+	ev.enter.root_x = x;
+	ev.enter.root_y = 10;
+	ev.enter.mode = XCB_NOTIFY_MODE_NORMAL;
+	ev.enter.detail = XCB_NOTIFY_DETAIL_NONLINEAR;
+	ev.generic.full_sequence = full_sequence;
+	handle_event(&ev.generic);
+}
+
+/* After a relayout has been committed and flushed, a crossing that the X
+ * server reports after processing everything still changes focus, while one
+ * caused by the relayout doesn't. */
+static void test_crossing_after_commit(void)
+{
+	conf.focus_mouse = true;
+	add_clients(2);
+	change_layout(mon, GRID);
+	configure_commit();
+	xb->flush();
+
+	enter_window(WIN_BASE + 1, 10, xb->layout_seq() - 1);
+	CHECK(mon->ws->c->win == WIN_BASE);
+	enter_window(WIN_BASE + 1, 20, xb->layout_seq());
+	CHECK(mon->ws->c->win == WIN_BASE + 1);
+}
+
+/**
+ * @brief Record the order of a workspace's clients.
+ *
+ * @param ws The workspace.
+ * @param wins Is filled with the clients' windows, from the head.
+ */
+static void list_wins(const workspace_t *ws, xcb_window_t *wins)
+{
+	client_t *c;
+
+	for (c = ws->head; c; c = c->next)
+		*wins++ = c->win;
+}
+
+/* Moving a client several places at once wraps around the ends of the list,
+ * just as moving it one place at a time does. */
+static void test_move_count_wraps(void)
+{
+	xcb_window_t before[4], stepped[4], counted[4];
+	int i;
+
+	add_clients(4);
+	update_focused_client(mon->ws->head->next->next);
+	list_wins(mon->ws, before);
+	for (i = 0; i < 3; i++)
+		move_current_down();
+	list_wins(mon->ws, stepped);
+
+	op_move_up(CLIENT, 3);
+	list_wins(mon->ws, counted);
+	CHECK(memcmp(before, counted, sizeof(before)) == 0);
+	op_move_down(CLIENT, 3);
+	list_wins(mon->ws, counted);
+	CHECK(memcmp(stepped, counted, sizeof(stepped)) == 0);
+	CHECK(mon->ws->c->win == before[2]);
+}
+
+/* Focusing another client in the zoom layout only restacks the client that
+ * is now shown, not the ones that it covers. */
+static void test_zoom_focus_restack(void)
+{
+	add_clients(30);
+	change_layout(mon, ZOOM);
+	configure_commit();
+	mock_reset();
+
+	update_focused_client(mon->ws->head->next);
+	configure_commit();
+	CHECK(mock_count("configure_window", XCB_CONFIG_WINDOW_STACK_MODE) == 1);
+	CHECK(mock_count("configure_window", 0) == 1);
+	CHECK(mock_count("change_window_attributes", 0) == 1);
+}
+
+/* The change_layout command selects the layout given by its argument, as
+ * "howmc change_layout 4" does. */
+static void test_ipc_change_layout(void)
+{
+	char name[] = "change_layout", arg[] = "4", big[] = "5";
+	char *args[] = { name, arg, NULL };
+
+	add_clients(2);
+	CHECK(ipc_run_function(args) == IPC_ERR_NONE);
+	CHECK(mon->ws->layout == TABBED);
+	args[1] = big;
+	CHECK(ipc_run_function(args) == IPC_ERR_ARG_TOO_LARGE);
+	CHECK(mon->ws->layout == TABBED);
+}
+
+/* A window's ConfigureRequest is passed on through the configure queue,
+ * while the ConfigureNotify that follows one of howm's configures is
+ * ignored. */
+static void test_configure_request(void)
+{
+	union {
+		xcb_generic_event_t generic;
+		xcb_configure_request_event_t request;
+		xcb_configure_notify_event_t notify;
+	} ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.request.response_type = XCB_CONFIGURE_REQUEST;
+	ev.request.window = WIN_BASE;
+	ev.request.width = 100;
+	ev.request.height = 50;
+	ev.request.value_mask = XCB_CONFIG_WINDOW_WIDTH
+		| XCB_CONFIG_WINDOW_HEIGHT;
+	handle_event(&ev.generic);
+	configure_commit();
+	CHECK(mock_count("configure_window", XCB_CONFIG_WINDOW_WIDTH
+				| XCB_CONFIG_WINDOW_HEIGHT) == 1);
+
+	add_clients(2);
+	memset(&ev, 0, sizeof(ev));
+	ev.notify.response_type = XCB_CONFIGURE_NOTIFY;
+	ev.notify.window = WIN_BASE;
+	ev.notify.width = 100;
+	handle_event(&ev.generic);
+	configure_commit();
+	CHECK(mock_request_cnt() == 0);
+}
+
+/* A scratchpad name is compared in full, and names that don't fit aren't
+ * stored. */
+static void test_scratchpad_long_name(void)
+{
+	char name[SCRATCHPAD_NAME_LEN + 1], longer[SCRATCHPAD_NAME_LEN + 1];
+
+	add_clients(3);
+	memset(longer, 'a', SCRATCHPAD_NAME_LEN);
+	longer[SCRATCHPAD_NAME_LEN] = '\0';
+	send_to_scratchpad(longer);
+	CHECK(list_len(mon->ws) == 3);
+
+	snprintf(name, sizeof(name), "%s", longer);
+	name[SCRATCHPAD_NAME_LEN - 1] = '\0';
+	send_to_scratchpad(name);
+	CHECK(list_len(mon->ws) == 2);
+	get_from_scratchpad(longer);
+	CHECK(list_len(mon->ws) == 2);
+	get_from_scratchpad(name);
+	CHECK(list_len(mon->ws) == 3);
+}
+
+/* Hiding a tiled client in a scratchpad rearranges the clients that are
+ * left, rather than leaving a hole where it was. */
+static void test_scratchpad_hide_arranges(void)
+{
+	xcb_rectangle_t rects[2];
+	client_t *c;
+	int i;
+
+	add_clients(3);
+	change_layout(mon, HSTACK);
+	send_to_scratchpad(NULL);
+	toggle_scratchpad(NULL);
+	toggle_float();
+	update_focused_client(mon->ws->head);
+	toggle_scratchpad(NULL);
+	CHECK(list_len(mon->ws) == 2);
+
+	for (c = mon->ws->head, i = 0; c; c = c->next, i++)
+		rects[i] = c->rect;
+	arrange_windows(mon);
+	for (c = mon->ws->head, i = 0; c; c = c->next, i++)
+		CHECK(memcmp(&rects[i], &c->rect, sizeof(c->rect)) == 0);
+}
+
+static const struct test tests[] = {
+	{ "evict_push_one_client", test_evict_push_one_client },
+	{ "evict_resize_one_client", test_evict_resize_one_client },
+	{ "cut_ws_from_empty", test_cut_ws_from_empty },
+	{ "crossing_after_commit", test_crossing_after_commit },
+	{ "move_count_wraps", test_move_count_wraps },
+	{ "zoom_focus_restack", test_zoom_focus_restack },
+	{ "ipc_change_layout", test_ipc_change_layout },
+	{ "configure_request", test_configure_request },
+	{ "scratchpad_long_name", test_scratchpad_long_name },
+	{ "scratchpad_hide_arranges", test_scratchpad_hide_arranges },
+};
+
+/**
+ * @brief Run a test in a child process.
+ *
+ * @param t The test.
+ *
+ * @return True if the test passed.
+ */
+static bool run_test(const struct test *t)
+{
+	pid_t pid;
+	int status;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(EXIT_FAILURE);
+	} else if (pid == 0) {
+		/* howm prints its state whenever it changes. */
+		if (!freopen("/dev/null", "w", stdout))
+			exit(EXIT_FAILURE);
+		mock_backend_init(1000, 1000);
+		t->fn();
+		exit(EXIT_SUCCESS);
+	}
+	if (waitpid(pid, &status, 0) < 0)
+		return false;
+	return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+/**
+ * @brief Check whether a test was asked for on the command line.
+ *
+ * @param t The test.
+ * @param argc The amount of arguments.
+ * @param argv The arguments, the names of the tests to run. All tests are
+ * run if there are none.
+ *
+ * @return True if the test should be run.
+ */
+static bool wanted(const struct test *t, int argc, char *argv[])
+{
+	int i;
+
+	if (argc < 2)
+		return true;
+	for (i = 1; i < argc; i++)
+		if (strcmp(argv[i], t->name) == 0)
+			return true;
+	return false;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int i, failed = 0, run = 0;
+
+	for (i = 0; i < LENGTH(tests); i++) {
+		if (!wanted(&tests[i], argc, argv))
+			continue;
+		run++;
+		if (run_test(&tests[i])) {
+			printf("ok %s\n", tests[i].name);
+		} else {
+			printf("FAIL %s\n", tests[i].name);
+			failed++;
+		}
+	}
+	printf("%u of %u tests passed\n", run - failed, run);
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}